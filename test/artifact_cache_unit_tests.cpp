@@ -0,0 +1,101 @@
+#include "artifact_cache.hpp"
+#include "utilities.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+class ArtifactCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    test_dir = fs::temp_directory_path() / "yakka_artifact_cache_test";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir / "project");
+    cache.init(test_dir / "cache", 1024 * 1024);
+  }
+
+  void TearDown() override
+  {
+    fs::remove_all(test_dir);
+  }
+
+  void write_file(const fs::path &path, const std::string &content)
+  {
+    std::ofstream file(path, std::ios_base::binary);
+    file << content;
+  }
+
+  std::string read_file(const fs::path &path)
+  {
+    std::ifstream file(path, std::ios_base::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  static std::optional<uint64_t> digest(const std::string &path)
+  {
+    return yakka::hash_file(path);
+  }
+
+  fs::path test_dir;
+  yakka::artifact_cache cache;
+};
+
+TEST_F(ArtifactCacheTest, RestoresStoredTarget)
+{
+  const auto target     = (test_dir / "project" / "main.o").string();
+  const auto dependency = (test_dir / "project" / "main.d").string();
+  const auto header     = (test_dir / "project" / "main.h").string();
+  write_file(target, "object");
+  write_file(dependency, "main.o: main.h");
+  write_file(header, "header");
+
+  nlohmann::json discovered;
+  discovered[header] = yakka::hash_bytes("header");
+  cache.store(1, target, { dependency }, discovered);
+  EXPECT_EQ(cache.stores, 1U);
+
+  fs::remove(target);
+  fs::remove(dependency);
+  EXPECT_TRUE(cache.restore(1, target, { dependency }, digest));
+  EXPECT_EQ(read_file(target), "object");
+  EXPECT_EQ(read_file(dependency), "main.o: main.h");
+  EXPECT_FALSE(cache.restore(2, target, { dependency }, digest));
+  EXPECT_EQ(cache.hits, 1U);
+  EXPECT_EQ(cache.misses, 1U);
+}
+
+TEST_F(ArtifactCacheTest, DiscoveredDependencyChangeIsMiss)
+{
+  const auto target = (test_dir / "project" / "main.o").string();
+  const auto header = (test_dir / "project" / "main.h").string();
+  write_file(target, "object");
+  write_file(header, "header");
+
+  nlohmann::json discovered;
+  discovered[header] = yakka::hash_bytes("header");
+  cache.store(1, target, {}, discovered);
+
+  write_file(header, "changed header");
+  EXPECT_FALSE(cache.restore(1, target, {}, digest));
+}
+
+TEST_F(ArtifactCacheTest, TrimEvictsLeastRecentlyUsed)
+{
+  const auto target = (test_dir / "project" / "main.o").string();
+  write_file(target, std::string(600 * 1024, 'x'));
+  cache.store(1, target, {}, nlohmann::json::object());
+  cache.store(2, target, {}, nlohmann::json::object());
+
+  // Age the second entry so it is the least recently used
+  const auto restored = (test_dir / "project" / "restored.o").string();
+  fs::last_write_time(test_dir / "cache" / "00" / "0000000000000002" / "manifest.json", fs::file_time_type::clock::now() - std::chrono::hours(1));
+  cache.trim();
+
+  EXPECT_TRUE(cache.restore(1, restored, {}, digest));
+  EXPECT_FALSE(cache.restore(2, restored, {}, digest));
+}
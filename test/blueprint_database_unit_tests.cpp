@@ -0,0 +1,138 @@
+#include "blueprint_database.hpp"
+#include "utilities.hpp"
+#include "yaml-cpp/yaml.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using matches_t = std::vector<std::string>;
+
+class BlueprintDatabaseTest : public ::testing::Test {
+protected:
+  void add_blueprint(const std::string &target, bool is_regex)
+  {
+    nlohmann::json blueprint = nlohmann::json::object();
+    if (is_regex)
+      blueprint["regex"] = target;
+    database.insert(target, std::make_shared<yakka::blueprint>(target, blueprint, "."));
+  }
+
+  // Regex capture groups of each matching blueprint
+  std::vector<matches_t> find(const std::string &target)
+  {
+    std::vector<matches_t> result;
+    for (const auto &m: database.find_match(target, summary))
+      result.push_back(m->regex_matches);
+    return result;
+  }
+
+  yakka::blueprint_database database;
+  nlohmann::json summary = nlohmann::json::object();
+};
+
+TEST_F(BlueprintDatabaseTest, MatchesInBlueprintOrder)
+{
+  add_blueprint("output/main.c.o", false);
+  add_blueprint("output/(m)ain\\.c\\.o", true);
+  add_blueprint("output/(.+)\\.c\\.o", true);
+  add_blueprint("output/main.c.o", false);
+  add_blueprint("output/other.c.o", false);
+
+  const auto result = database.find_match("output/main.c.o", summary);
+  ASSERT_EQ(result.size(), 4);
+  auto blueprint = database.blueprints.begin();
+  for (const auto &m: result) {
+    while (blueprint->first == "output/other.c.o")
+      ++blueprint;
+    EXPECT_EQ(m->blueprint, blueprint->second);
+    ++blueprint;
+  }
+  EXPECT_EQ(result[0]->regex_matches, (matches_t{ "output/main.c.o", "main" }));
+  EXPECT_EQ(result[1]->regex_matches, (matches_t{ "output/main.c.o", "m" }));
+  EXPECT_EQ(result[2]->regex_matches, (matches_t{ "output/main.c.o" }));
+}
+
+TEST_F(BlueprintDatabaseTest, MatchesRegexWithoutLiteralAffixes)
+{
+  add_blueprint("ab*c", true);
+  add_blueprint("x|y\\.o", true);
+  add_blueprint("[.]src/(.*)\\.cpp", true);
+  add_blueprint("lib(a)?\\.a", true);
+  add_blueprint("\\d+\\.txt", true);
+  add_blueprint("(out/)?a{2,3}\\(1\\)", true);
+
+  EXPECT_EQ(find("ac").size(), 1);
+  EXPECT_EQ(find("abbc").size(), 1);
+  EXPECT_EQ(find("x").size(), 1);
+  EXPECT_EQ(find("y.o").size(), 1);
+  EXPECT_EQ(find(".src/a.cpp"), (std::vector<matches_t>{ { ".src/a.cpp", "a" } }));
+  EXPECT_EQ(find("lib.a").size(), 1);
+  EXPECT_EQ(find("liba.a").size(), 1);
+  EXPECT_EQ(find("42.txt").size(), 1);
+  EXPECT_EQ(find("aaa(1)").size(), 1);
+  EXPECT_EQ(find("out/aa(1)").size(), 1);
+  EXPECT_TRUE(find("abd").empty());
+  EXPECT_TRUE(find("src/a.cpp").empty());
+  EXPECT_TRUE(find("a(1)").empty());
+}
+
+TEST_F(BlueprintDatabaseTest, IgnoresInvalidRegex)
+{
+  add_blueprint("output/(.+\\.o", true);
+  add_blueprint("output/(.+)\\.o", true);
+
+  EXPECT_EQ(database.blueprints.size(), 2);
+  EXPECT_EQ(find("output/a.o"), (std::vector<matches_t>{ { "output/a.o", "a" } }));
+}
+
+TEST_F(BlueprintDatabaseTest, MatchesFromSeveralThreads)
+{
+  add_blueprint("output/(.+)\\.c\\.o", true);
+  add_blueprint("output/(.+)\\.cpp\\.o", true);
+  add_blueprint("link", false);
+
+  std::vector<std::thread> threads;
+  std::vector<size_t> match_counts(4, 0);
+  for (size_t t = 0; t < match_counts.size(); ++t)
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < 200; ++i) {
+        const auto result = database.find_match("output/file" + std::to_string(i) + ".c.o", summary);
+        if (result.size() == 1 && result[0]->regex_matches[1] == "file" + std::to_string(i))
+          ++match_counts[t];
+      }
+    });
+  for (auto &t: threads)
+    t.join();
+
+  EXPECT_EQ(match_counts, std::vector<size_t>(4, 200));
+}
+
+TEST_F(BlueprintDatabaseTest, ExpandsListDependency)
+{
+  const nlohmann::json blueprint = { { "depends",
+                                       { { { "list", "{% for name, component in components %}{% for source in component.sources %}{{ append(\"out/\", name, \"/\", source, \".o\") }}{% endfor %}{% endfor %}{{ append(extra) }}" } },
+                                         "[./a.txt, b.txt, ]" } } };
+  database.insert("link", std::make_shared<yakka::blueprint>("link", blueprint, "."));
+  summary["components"]["core"]["sources"] = { "main.c", "util.c" };
+  summary["components"]["hal"]["sources"]  = { "gpio.c" };
+  summary["extra"]                         = { "x.ld", "./y.ld" };
+
+  const auto result = database.find_match("link", summary);
+  ASSERT_EQ(result.size(), 1u);
+  EXPECT_EQ(result[0]->dependencies, (matches_t{ "out/core/main.c.o", "out/core/util.c.o", "out/hal/gpio.c.o", "x.ld", "y.ld", "a.txt", "b.txt" }));
+}
+
+TEST(FlowSequenceTest, MatchesYaml)
+{
+  for (const std::string text: { "[]", "[ ]", "[a]", "[a, b, c]", "[a,b,c, ]", "[ out/x y.o , C:/dir/a.o ]", "[a-b, c.o]" }) {
+    const auto items = yakka::parse_flow_sequence(text);
+    ASSERT_TRUE(items.has_value()) << text;
+    matches_t expected;
+    for (const auto &i: YAML::Load(text))
+      expected.push_back(i.Scalar());
+    EXPECT_EQ(items.value(), expected) << text;
+  }
+
+  // These need the YAML parser
+  for (const std::string text: { "[\"a, b\", c]", "[a: b]", "[[a], b]", "[a, , b]", "[*a]", "[a #b]", "[a\n, b]", "a, b" })
+    EXPECT_FALSE(yakka::parse_flow_sequence(text).has_value()) << text;
+}
@@ -0,0 +1,55 @@
+#include "build_trace.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+TEST(BuildTraceTest, DisabledTraceRecordsNothing)
+{
+  const auto path = fs::temp_directory_path() / "yakka_disabled_trace.json";
+  yakka::build_trace trace;
+  {
+    yakka::build_trace::scope scope(trace, "main.o", "process");
+  }
+  ASSERT_TRUE(trace.save(path));
+
+  std::ifstream trace_file(path);
+  const auto json = nlohmann::json::parse(trace_file);
+  EXPECT_TRUE(json["traceEvents"].empty());
+  trace_file.close();
+  fs::remove(path);
+}
+
+TEST(BuildTraceTest, RecordsCompleteEvents)
+{
+  const auto path = fs::temp_directory_path() / "yakka_trace.json";
+  yakka::build_trace trace;
+  trace.enable();
+  {
+    yakka::build_trace::scope scope(trace, "main.o", "process");
+    scope.args["exit_code"] = 1;
+  }
+  {
+    yakka::build_trace::scope scope(trace, "main.c", "stat");
+  }
+  ASSERT_TRUE(trace.save(path));
+
+  std::ifstream trace_file(path);
+  const auto json = nlohmann::json::parse(trace_file);
+  const auto &events = json["traceEvents"];
+
+  // The first event names the thread
+  ASSERT_EQ(events.size(), 3U);
+  EXPECT_EQ(events[0]["ph"], "M");
+  EXPECT_EQ(events[1]["name"], "main.o");
+  EXPECT_EQ(events[1]["cat"], "process");
+  EXPECT_EQ(events[1]["ph"], "X");
+  EXPECT_EQ(events[1]["args"]["exit_code"], 1);
+  EXPECT_EQ(events[2]["cat"], "stat");
+  EXPECT_FALSE(events[2].contains("args"));
+  EXPECT_EQ(events[1]["tid"], events[2]["tid"]);
+  EXPECT_LE(events[1]["ts"].get<int64_t>(), events[2]["ts"].get<int64_t>());
+  trace_file.close();
+  fs::remove(path);
+}
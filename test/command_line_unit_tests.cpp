@@ -0,0 +1,115 @@
+#include "utilities.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using arguments_t = std::vector<std::string>;
+
+TEST(CommandLineTest, SplitsOnWhitespace)
+{
+  EXPECT_EQ(yakka::split_command_line("g++  -c main.cpp\t-o main.o"), (arguments_t{ "g++", "-c", "main.cpp", "-o", "main.o" }));
+  EXPECT_EQ(yakka::split_command_line("gcc @output/options -o output/app"), (arguments_t{ "gcc", "@output/options", "-o", "output/app" }));
+}
+
+TEST(CommandLineTest, RemovesQuotes)
+{
+  EXPECT_EQ(yakka::split_command_line("gcc -DNAME=\\\"yakka\\\" 'a b.c' \"c d.c\""), (arguments_t{ "gcc", "-DNAME=\"yakka\"", "a b.c", "c d.c" }));
+  EXPECT_EQ(yakka::split_command_line("echo '' \"a\\\"b\" 'it''s'"), (arguments_t{ "echo", "", "a\"b", "its" }));
+  EXPECT_EQ(yakka::split_command_line("echo 'a|b;c$d'"), (arguments_t{ "echo", "a|b;c$d" }));
+}
+
+TEST(CommandLineTest, RequiresShell)
+{
+  EXPECT_FALSE(yakka::split_command_line("gcc main.c | tee log").has_value());
+  EXPECT_FALSE(yakka::split_command_line("gcc main.c > log").has_value());
+  EXPECT_FALSE(yakka::split_command_line("make && make install").has_value());
+  EXPECT_FALSE(yakka::split_command_line("echo $HOME").has_value());
+  EXPECT_FALSE(yakka::split_command_line("echo \"$HOME\"").has_value());
+  EXPECT_FALSE(yakka::split_command_line("rm *.o").has_value());
+  EXPECT_FALSE(yakka::split_command_line("ls ~/bin").has_value());
+  EXPECT_FALSE(yakka::split_command_line("CC=gcc make").has_value());
+  EXPECT_FALSE(yakka::split_command_line("echo 'unterminated").has_value());
+  EXPECT_FALSE(yakka::split_command_line("  ").has_value());
+}
+
+TEST(CommandLineTest, FormatsResponseFile)
+{
+  EXPECT_EQ(yakka::format_response_file("-DNAME=1 -o 'out dir/app' a.o"), "-DNAME=1\n-o\nout\\ dir/app\na.o\n");
+  EXPECT_EQ(yakka::format_response_file("-DNAME=\\\"yakka\\\" ''"), "-DNAME=\\\"yakka\\\"\n\"\"\n");
+  EXPECT_FALSE(yakka::format_response_file("a.o > log").has_value());
+}
+
+TEST(CommandLineTest, WritesFileOnlyWhenChanged)
+{
+  const auto path = std::filesystem::temp_directory_path() / "yakka_write_if_changed_test" / "args.rsp";
+  std::filesystem::remove_all(path.parent_path());
+  EXPECT_EQ(yakka::write_file_if_changed(path, "a.o"), true);
+  EXPECT_EQ(yakka::write_file_if_changed(path, "a.o"), false);
+  EXPECT_EQ(yakka::write_file_if_changed(path, "b.o"), true);
+  EXPECT_EQ(yakka::get_file_contents<std::string>(path.string()), "b.o");
+  std::filesystem::remove_all(path.parent_path());
+}
+
+#if defined(__linux__)
+TEST(CommandLineTest, PassesOutputByLine)
+{
+  // A pipe needs the shell so the command is run through /bin/sh
+  std::vector<std::string> lines;
+  const auto retcode = yakka::exec("printf 'one\\ntwo\\nthree' | cat", "", [&](std::string &line) {
+    lines.push_back(line);
+  });
+  EXPECT_EQ(retcode, 0);
+  EXPECT_EQ(lines, (arguments_t{ "one\n", "two\n", "three" }));
+}
+
+TEST(CommandLineTest, TerminatesRunningProcesses)
+{
+  using namespace std::chrono_literals;
+  const auto start = std::chrono::steady_clock::now();
+  // The background sleep holds the output pipe open so exec only returns once the whole process group is gone
+  auto running = std::async(std::launch::async, []() {
+    yakka::build_task_scope build_task;
+    return yakka::exec("sh", "-c 'sleep 5 & wait'");
+  });
+  std::this_thread::sleep_for(200ms);
+  yakka::terminate_running_processes();
+  EXPECT_NE(running.get().second, 0);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 4s);
+
+  // Only build tools are stopped, tools started for the workspace still run
+  EXPECT_EQ(yakka::exec("true", "").second, 0);
+  {
+    yakka::build_task_scope build_task;
+    EXPECT_EQ(yakka::exec("true", "").second, -1);
+  }
+  yakka::reset_process_termination();
+  yakka::build_task_scope build_task;
+  EXPECT_EQ(yakka::exec("true", "").second, 0);
+}
+
+TEST(CommandLineTest, TerminatesShellCommands)
+{
+  using namespace std::chrono_literals;
+  const auto start = std::chrono::steady_clock::now();
+  auto running     = std::async(std::launch::async, []() {
+    yakka::build_task_scope build_task;
+    return yakka::exec("sleep 5 | cat", "");
+  });
+  std::this_thread::sleep_for(200ms);
+  yakka::terminate_running_processes();
+  EXPECT_NE(running.get().second, 0);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 4s);
+
+  // Later steps of a task that need a shell don't start either
+  {
+    yakka::build_task_scope build_task;
+    EXPECT_EQ(yakka::exec("true | true", "").second, -1);
+    EXPECT_EQ(yakka::exec_shell("true").second, -1);
+  }
+  yakka::reset_process_termination();
+  yakka::build_task_scope build_task;
+  EXPECT_EQ(yakka::exec("true | true", "").second, 0);
+}
+#endif
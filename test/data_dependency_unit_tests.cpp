@@ -1,6 +1,8 @@
 #include "utilities.hpp"
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
+#include <filesystem>
+#include <functional>
 
 namespace {
     // Test fixture for yakka::has_data_dependency_changed tests
@@ -130,4 +132,85 @@ namespace {
         ASSERT_TRUE(result.has_value());
         EXPECT_FALSE(*result);
     }
-}
\ No newline at end of file
+
+    // The summary index gives the same answers as comparing the summaries
+    TEST_F(DataDependencyTest, IndexMatchesSummaries) {
+        const std::vector<std::string> paths = {
+            ":/comp1/data/value", ":/comp1/data", ":/comp2/data/value", ":/comp3/data/value",
+            ":/comp1/nonexistent/path", ":/*/data/value", ":/*/data/name", ":/*/missing"
+        };
+        const std::vector<std::function<void(nlohmann::json &)>> modifications = {
+            [](nlohmann::json &) {},
+            [](nlohmann::json &json) { json["components"]["comp1"]["data"]["value"] = 43; },
+            [](nlohmann::json &json) { json["components"]["comp1"]["data"]["value"] = "42"; },
+            [](nlohmann::json &json) { json["components"]["comp2"]["data"]["name"] = "changed"; },
+            [](nlohmann::json &json) { json["components"]["comp3"] = {{"data", {{"value", 200}}}}; },
+            [](nlohmann::json &json) { json["components"].erase("comp2"); },
+            [](nlohmann::json &json) { json["components"]["comp1"]["data"]["extra"] = {1, 2}; },
+        };
+
+        yakka::summary_index previous;
+        previous.build(base_json);
+        for (size_t m = 0; m < modifications.size(); ++m) {
+            auto modified_json = base_json;
+            modifications[m](modified_json);
+            yakka::summary_index current;
+            current.build(modified_json);
+            for (const auto &path: paths) {
+                const auto expected = yakka::has_data_dependency_changed(path, base_json, modified_json);
+                const auto result = yakka::has_data_dependency_changed(path, previous, current);
+                ASSERT_TRUE(expected.has_value());
+                ASSERT_TRUE(result.has_value());
+                EXPECT_EQ(*result, *expected) << "Modification " << m << " of " << path;
+            }
+        }
+    }
+
+    TEST_F(DataDependencyTest, IndexInsideArray) {
+        auto array_json = base_json;
+        array_json["components"]["comp1"]["flags"] = {"-O2", "-g"};
+        yakka::summary_index previous;
+        previous.build(array_json);
+        array_json["components"]["comp1"]["flags"][1] = "-g3";
+        yakka::summary_index current;
+        current.build(array_json);
+        EXPECT_TRUE(*yakka::has_data_dependency_changed(":/comp1/flags/1", previous, current));
+        EXPECT_FALSE(*yakka::has_data_dependency_changed(":/comp1/data", previous, current));
+    }
+
+    TEST_F(DataDependencyTest, IndexSaveAndLoad) {
+        auto escaped_json = base_json;
+        escaped_json["components"]["comp1"]["a/b~c"] = 1;
+        yakka::summary_index index;
+        index.build(escaped_json);
+        const auto path = (std::filesystem::temp_directory_path() / "yakka_summary_index_test.json").string();
+        index.save(path);
+
+        yakka::summary_index loaded;
+        loaded.load(path);
+        std::filesystem::remove(path);
+        EXPECT_FALSE(*yakka::has_data_dependency_changed(":/*/data/value", loaded, index));
+        EXPECT_FALSE(*yakka::has_data_dependency_changed(":/comp1/a~1b~0c", loaded, index));
+        EXPECT_TRUE(loaded.find("comp1", "/a~1b~0c").has_value());
+        EXPECT_EQ(yakka::hash_data_dependency(":/*/data", loaded), yakka::hash_data_dependency(":/*/data", index));
+        EXPECT_TRUE(*yakka::has_data_dependency_changed(":/comp1/data", yakka::summary_index(), index));
+    }
+
+    // Wildcard digests are kept per index and start again when it is rebuilt
+    TEST_F(DataDependencyTest, IndexWildcardDigest) {
+        yakka::summary_index index;
+        index.build(base_json);
+        EXPECT_EQ(index.component_names(), (std::vector<std::string>{ "comp1", "comp2" }));
+        const auto digest = index.wildcard_digest("/data/value");
+        EXPECT_EQ(index.wildcard_digest("/data/value"), digest);
+        EXPECT_NE(index.wildcard_digest("/data/name"), digest);
+
+        const auto copy = index;
+        auto modified_json = base_json;
+        modified_json["components"]["comp2"]["data"]["value"] = 101;
+        index.build(modified_json);
+        EXPECT_NE(index.wildcard_digest("/data/value"), digest);
+        EXPECT_EQ(copy.wildcard_digest("/data/value"), digest);
+        EXPECT_EQ(index.wildcard_digest("/data/name"), copy.wildcard_digest("/data/name"));
+    }
+}
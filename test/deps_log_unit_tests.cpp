@@ -0,0 +1,100 @@
+#include "deps_log.hpp"
+#include "utilities.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+using dependencies_t = std::vector<std::string>;
+
+class DepsLogTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    test_dir = fs::temp_directory_path() / "yakka_deps_log_test";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+    log_path        = (test_dir / ".yakka_deps").string();
+    dependency_file = (test_dir / "main.d").string();
+  }
+
+  void TearDown() override
+  {
+    fs::remove_all(test_dir);
+  }
+
+  void write_file(const std::string &path, const std::string &content)
+  {
+    std::ofstream file(path, std::ios_base::binary);
+    file << content;
+  }
+
+  fs::path test_dir;
+  std::string log_path;
+  std::string dependency_file;
+};
+
+TEST_F(DepsLogTest, ParsesDependencyFile)
+{
+  write_file(dependency_file, "out/main.o: main.c dir\\ with\\ space/a.h \\\n  ./b.h $$c.h \\\r\n C:/d.h\n\nb.h:\n");
+  EXPECT_EQ(yakka::parse_gcc_dependency_file(dependency_file), (dependencies_t{ "main.c", "dir with space/a.h", "b.h", "$c.h", "C:/d.h" }));
+  write_file(dependency_file, "main.o: main.c");
+  EXPECT_EQ(yakka::parse_gcc_dependency_file(dependency_file), (dependencies_t{ "main.c" }));
+  EXPECT_TRUE(yakka::parse_gcc_dependency_file((test_dir / "missing.d").string()).empty());
+}
+
+TEST_F(DepsLogTest, SkipsUnchangedFiles)
+{
+  write_file(dependency_file, "main.o: main.c a.h\n");
+  const auto recorded_time = fs::last_write_time(dependency_file);
+  {
+    yakka::deps_log log;
+    log.open(log_path);
+    EXPECT_EQ(log.dependencies(dependency_file), (dependencies_t{ "main.c", "a.h" }));
+  }
+
+  // A file that kept its timestamp is not parsed again
+  write_file(dependency_file, "main.o: main.c b.h\n");
+  fs::last_write_time(dependency_file, recorded_time);
+  {
+    yakka::deps_log log;
+    log.open(log_path);
+    EXPECT_EQ(log.dependencies(dependency_file), (dependencies_t{ "main.c", "a.h" }));
+
+    fs::last_write_time(dependency_file, recorded_time + std::chrono::seconds(1));
+    EXPECT_EQ(log.dependencies(dependency_file), (dependencies_t{ "main.c", "b.h" }));
+  }
+
+  yakka::deps_log log;
+  log.open(log_path);
+  fs::last_write_time(dependency_file, recorded_time);
+  EXPECT_EQ(log.dependencies(dependency_file), (dependencies_t{ "main.c", "b.h" }));
+  EXPECT_TRUE(log.dependencies((test_dir / "missing.d").string()).empty());
+}
+
+TEST_F(DepsLogTest, IgnoresTruncatedRecords)
+{
+  write_file(dependency_file, "main.o: main.c a.h\n");
+  {
+    yakka::deps_log log;
+    log.open(log_path);
+    log.dependencies(dependency_file);
+  }
+  const auto valid_size = fs::file_size(log_path);
+  {
+    std::ofstream file(log_path, std::ios_base::binary | std::ios_base::app);
+    file.write("\x10\x00\x00\x80partial", 11);
+  }
+
+  yakka::deps_log log;
+  log.open(log_path);
+  EXPECT_EQ(fs::file_size(log_path), valid_size);
+  write_file(dependency_file, "main.o: main.c\n");
+  fs::last_write_time(dependency_file, fs::last_write_time(dependency_file) + std::chrono::seconds(1));
+  EXPECT_EQ(log.dependencies(dependency_file), (dependencies_t{ "main.c" }));
+  log.close();
+
+  log.open(log_path);
+  EXPECT_EQ(log.dependencies(dependency_file), (dependencies_t{ "main.c" }));
+}
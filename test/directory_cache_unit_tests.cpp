@@ -0,0 +1,162 @@
+#include "directory_cache.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+using paths_t = std::vector<std::string>;
+
+class DirectoryCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    test_dir = fs::temp_directory_path() / "yakka_directory_cache_test";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+    root = test_dir.generic_string();
+  }
+
+  void TearDown() override
+  {
+    fs::remove_all(test_dir);
+  }
+
+  void write_file(const std::string &path)
+  {
+    fs::create_directories((test_dir / path).parent_path());
+    std::ofstream file(test_dir / path, std::ios_base::binary);
+    file << path;
+  }
+
+  // Moves the timestamp of a directory back so its listing is old enough to be cached
+  void age(const std::string &path, std::chrono::minutes age)
+  {
+    fs::last_write_time(test_dir / path, fs::file_time_type::clock::now() - age);
+  }
+
+  paths_t glob(const std::string &pattern)
+  {
+    paths_t result;
+    for (const auto &p: cache.glob(root + "/" + pattern))
+      result.push_back(p.substr(root.size() + 1));
+    return result;
+  }
+
+  fs::path test_dir;
+  std::string root;
+  yakka::directory_cache cache;
+};
+
+TEST(DirectoryCacheMatchTest, MatchesWildcards)
+{
+  EXPECT_TRUE(yakka::directory_cache::match("main.c", "*.c"));
+  EXPECT_TRUE(yakka::directory_cache::match("main.c", "m?in.*"));
+  EXPECT_TRUE(yakka::directory_cache::match("main.c", "*"));
+  EXPECT_TRUE(yakka::directory_cache::match("aaab", "*a*b"));
+  EXPECT_FALSE(yakka::directory_cache::match("main.cpp", "*.c"));
+  EXPECT_FALSE(yakka::directory_cache::match("main.c", "?"));
+  EXPECT_FALSE(yakka::directory_cache::match("", "?"));
+}
+
+TEST(DirectoryCacheMatchTest, MatchesCharacterSets)
+{
+  EXPECT_TRUE(yakka::directory_cache::match("file3.txt", "file[0-9].txt"));
+  EXPECT_FALSE(yakka::directory_cache::match("filex.txt", "file[0-9].txt"));
+  EXPECT_TRUE(yakka::directory_cache::match("filex.txt", "file[!0-9].txt"));
+  EXPECT_TRUE(yakka::directory_cache::match("a]", "a[]]"));
+  EXPECT_TRUE(yakka::directory_cache::match("a[b", "a[b"));
+}
+
+TEST_F(DirectoryCacheTest, ExpandsPatterns)
+{
+  write_file("src/main.c");
+  write_file("src/util.c");
+  write_file("src/util.h");
+  write_file("src/.hidden.c");
+  write_file("src/drivers/uart.c");
+  write_file("src/drivers/spi/spi.c");
+  write_file("src/.git/config.c");
+
+  EXPECT_EQ(glob("src/*.c"), (paths_t{ "src/main.c", "src/util.c" }));
+  EXPECT_EQ(glob("src/.*.c"), (paths_t{ "src/.hidden.c" }));
+  EXPECT_EQ(glob("src/**/*.c"), (paths_t{ "src/drivers/spi/spi.c", "src/drivers/uart.c" }));
+  EXPECT_EQ(glob("*/drivers/*.c"), (paths_t{ "src/drivers/uart.c" }));
+  EXPECT_EQ(glob("src/*/"), (paths_t{ "src/drivers/" }));
+  EXPECT_EQ(glob("src/**"), (paths_t{ "src/drivers", "src/drivers/spi", "src/drivers/spi/spi.c", "src/drivers/uart.c", "src/main.c", "src/util.c", "src/util.h" }));
+  EXPECT_EQ(glob("src/main.c"), (paths_t{ "src/main.c" }));
+  EXPECT_TRUE(glob("src/missing.c").empty());
+  EXPECT_TRUE(glob("missing/*.c").empty());
+}
+
+TEST_F(DirectoryCacheTest, ConcatenatesPatterns)
+{
+  write_file("a.c");
+  write_file("b.h");
+
+  const auto result = cache.glob(paths_t{ root + "/*.h", root + "/*.c" });
+  EXPECT_EQ(result, (paths_t{ root + "/b.h", root + "/a.c" }));
+}
+
+TEST_F(DirectoryCacheTest, ReusesUnchangedListing)
+{
+  write_file("src/main.c");
+  age("src", std::chrono::minutes(60));
+
+  const auto first = cache.list(root + "/src");
+  EXPECT_EQ(cache.list(root + "/src/"), first);
+  ASSERT_EQ(first->entries.size(), 1U);
+
+  // Adding a file changes the timestamp of the directory
+  write_file("src/util.c");
+  age("src", std::chrono::minutes(30));
+  const auto second = cache.list(root + "/src");
+  EXPECT_NE(second, first);
+  EXPECT_EQ(second->entries.size(), 2U);
+  EXPECT_EQ(glob("src/*.c"), (paths_t{ "src/main.c", "src/util.c" }));
+}
+
+TEST_F(DirectoryCacheTest, DoesNotCacheRecentlyChangedListing)
+{
+  write_file("src/main.c");
+
+  const auto first = cache.list(root + "/src");
+  EXPECT_NE(cache.list(root + "/src"), first);
+  EXPECT_TRUE(cache.list(root + "/missing")->entries.empty());
+}
+
+TEST_F(DirectoryCacheTest, ReportsListedDirectories)
+{
+  write_file("old/main.c");
+  write_file("new/main.c");
+  age("old", std::chrono::minutes(60));
+  cache.list(root + "/old");
+  cache.list(root + "/new");
+  cache.list(root + "/missing");
+
+  auto listed = cache.listed_directories();
+  std::sort(listed.begin(), listed.end());
+  ASSERT_EQ(listed.size(), 3U);
+  EXPECT_EQ(listed[0].first, root + "/missing");
+  EXPECT_EQ(listed[0].second, fs::file_time_type::min());
+  EXPECT_EQ(listed[1].first, root + "/new");
+  EXPECT_EQ(listed[1].second, fs::last_write_time(test_dir / "new"));
+  EXPECT_EQ(listed[2].first, root + "/old");
+  EXPECT_EQ(listed[2].second, fs::last_write_time(test_dir / "old"));
+
+  cache.clear();
+  EXPECT_TRUE(cache.listed_directories().empty());
+}
+
+TEST_F(DirectoryCacheTest, WalksLargeTreeInParallel)
+{
+  for (int i = 0; i < 200; ++i)
+    write_file("tree/dir" + std::to_string(i) + "/sub/file.slcc");
+
+  const auto result = glob("tree/**/*.slcc");
+  ASSERT_EQ(result.size(), 200U);
+  EXPECT_EQ(result.front(), "tree/dir0/sub/file.slcc");
+  EXPECT_EQ(glob("tree/**/").size(), 400U);
+}
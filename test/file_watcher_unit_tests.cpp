@@ -0,0 +1,88 @@
+#include "file_watcher.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+class FileWatcherTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    test_dir = fs::temp_directory_path() / "yakka_file_watcher_test";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+    watched   = (test_dir / "main.c").string();
+    unwatched = (test_dir / "other.c").string();
+    write_file(watched, "content");
+    write_file(unwatched, "content");
+  }
+
+  void TearDown() override
+  {
+    fs::remove_all(test_dir);
+  }
+
+  void write_file(const fs::path &path, const std::string &content)
+  {
+    std::ofstream file(path, std::ios_base::binary);
+    file << content;
+  }
+
+  fs::path test_dir;
+  std::string watched;
+  std::string unwatched;
+  yakka::file_watcher watcher;
+};
+
+TEST_F(FileWatcherTest, ReportsChangedFile)
+{
+  watcher.watch({ watched });
+  EXPECT_TRUE(watcher.wait(10ms).empty());
+
+  // Polling relies on the timestamp so make sure it moves
+  write_file(watched, "changed");
+  fs::last_write_time(watched, fs::file_time_type::clock::now() + 1s);
+  const auto changes = watcher.wait(2s);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0], watched);
+}
+
+TEST_F(FileWatcherTest, ReportsChangesBeforeWatchIsRenewed)
+{
+  watcher.watch({ watched });
+  write_file(watched, "changed");
+  fs::last_write_time(watched, fs::file_time_type::clock::now() + 1s);
+  ASSERT_EQ(watcher.wait(2s).size(), 1U);
+
+  // Files edited while a build runs are reported once the build renews the watched files
+  write_file(watched, "changed again");
+  fs::last_write_time(watched, fs::file_time_type::clock::now() + 2s);
+  watcher.watch({ watched, unwatched });
+  const auto changes = watcher.wait(2s);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0], watched);
+}
+
+TEST_F(FileWatcherTest, IgnoresOtherFiles)
+{
+  watcher.watch({ watched });
+  write_file(unwatched, "changed");
+  fs::last_write_time(unwatched, fs::file_time_type::clock::now() + 1s);
+  EXPECT_TRUE(watcher.wait(200ms).empty());
+}
+
+TEST_F(FileWatcherTest, ReportsReplacedFile)
+{
+  watcher.watch({ watched });
+
+  // Editors often save by renaming a new file over the old one
+  const auto replacement = test_dir / "main.c.tmp";
+  write_file(replacement, "replaced");
+  fs::last_write_time(replacement, fs::file_time_type::clock::now() + 1s);
+  fs::rename(replacement, watched);
+  const auto changes = watcher.wait(2s);
+  ASSERT_EQ(changes.size(), 1U);
+  EXPECT_EQ(changes[0], watched);
+}
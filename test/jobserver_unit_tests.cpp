@@ -0,0 +1,86 @@
+#include "jobserver.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+using namespace std::chrono_literals;
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+class JobserverTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    if (const char *value = std::getenv("MAKEFLAGS"); value != nullptr)
+      makeflags = value;
+    ::unsetenv("MAKEFLAGS");
+  }
+
+  void TearDown() override
+  {
+    if (makeflags.has_value())
+      ::setenv("MAKEFLAGS", makeflags->c_str(), 1);
+    else
+      ::unsetenv("MAKEFLAGS");
+  }
+
+  std::optional<std::string> makeflags;
+};
+
+TEST_F(JobserverTest, ExportsFifoAndDescriptors)
+{
+  yakka::jobserver server;
+  server.init(2);
+  const std::string exported = std::getenv("MAKEFLAGS");
+  EXPECT_NE(exported.find("-j2"), std::string::npos);
+  EXPECT_NE(exported.find("--jobserver-auth=fifo:"), std::string::npos);
+  EXPECT_NE(exported.find("--jobserver-fds="), std::string::npos);
+
+  // A client joins through the FIFO and shares the single token beyond the implicit one
+  yakka::jobserver client;
+  client.init(0);
+  EXPECT_TRUE(client.is_client());
+  EXPECT_EQ(client.job_count(), 2U);
+  const auto implicit = server.acquire();
+  const auto shared   = client.acquire();
+}
+
+TEST_F(JobserverTest, WaitingWorkerTakesReturnedImplicitToken)
+{
+  yakka::jobserver server;
+  server.init(2);
+
+  // The only explicit token is held by another worker so the waiting worker can only get the implicit token
+  std::atomic<bool> held     = false;
+  std::atomic<bool> done     = false;
+  std::atomic<bool> acquired = false;
+  std::thread holder;
+  std::thread waiting;
+  {
+    const auto implicit = server.acquire();
+    holder              = std::thread([&]() {
+      const auto token = server.acquire();
+      held             = true;
+      while (!done)
+        std::this_thread::sleep_for(10ms);
+    });
+    while (!held)
+      std::this_thread::sleep_for(10ms);
+    waiting = std::thread([&]() {
+      const auto token = server.acquire();
+      acquired         = true;
+    });
+    std::this_thread::sleep_for(200ms);
+    EXPECT_FALSE(acquired);
+  }
+  for (int i = 0; i < 50 && !acquired; ++i)
+    std::this_thread::sleep_for(100ms);
+  EXPECT_TRUE(acquired);
+  done = true;
+  holder.join();
+  waiting.join();
+}
+#endif
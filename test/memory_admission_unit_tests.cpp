@@ -0,0 +1,85 @@
+#include "memory_admission.hpp"
+#include "utilities.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+  #include <unistd.h>
+#endif
+
+using namespace std::chrono_literals;
+
+TEST(MemoryAdmissionTest, UnlimitedUntilEnabled)
+{
+  yakka::memory_admission admission;
+  EXPECT_FALSE(admission.is_enabled());
+  const auto first  = admission.admit(UINT64_MAX / 2);
+  const auto second = admission.admit(UINT64_MAX / 2);
+}
+
+TEST(MemoryAdmissionTest, WaitsForMemory)
+{
+  yakka::memory_admission admission;
+  admission.enable();
+  if (!admission.is_enabled())
+    GTEST_SKIP() << "Available memory is unknown";
+
+  std::atomic<bool> admitted = false;
+  std::thread waiting;
+  {
+    // The first command is always admitted so the second can't fit until it finishes
+    const auto first = admission.admit(UINT64_MAX / 2);
+    waiting          = std::thread([&]() {
+      const auto second = admission.admit(UINT64_MAX / 2);
+      admitted          = true;
+    });
+    std::this_thread::sleep_for(200ms);
+    EXPECT_FALSE(admitted);
+  }
+  waiting.join();
+  EXPECT_TRUE(admitted);
+}
+
+#if defined(__linux__)
+TEST(MemoryAdmissionTest, CountsOnlyUnrealisedMemory)
+{
+  yakka::memory_admission admission;
+  admission.enable();
+  if (!admission.is_enabled())
+    GTEST_SKIP() << "Available memory is unknown";
+
+  // Memory this process already uses is no longer available, so a reservation it covers leaves all of it to others
+  std::vector<char> touched(64 * 1024 * 1024, 1);
+  const auto resident = yakka::memory_admission::resident_memory(::getpid());
+  ASSERT_TRUE(resident.has_value());
+  ASSERT_GT(resident.value(), touched.size() / 1024);
+
+  const auto first = admission.admit(resident.value() / 2);
+  yakka::memory_admission::add_process(::getpid());
+  std::atomic<bool> admitted = false;
+  std::thread waiting([&]() {
+    const auto second = admission.admit(yakka::memory_admission::available_memory().value() - resident.value() / 4);
+    admitted          = true;
+  });
+  for (int i = 0; i < 50 && !admitted; ++i)
+    std::this_thread::sleep_for(100ms);
+  EXPECT_TRUE(admitted);
+  yakka::memory_admission::remove_process(::getpid());
+  waiting.join();
+}
+
+TEST(MemoryAdmissionTest, RecordsProcessUsage)
+{
+  yakka::process_usage usage;
+  const auto [output, retcode] = yakka::exec("true", "", &usage);
+  EXPECT_EQ(retcode, 0);
+  EXPECT_GT(usage.peak_memory, 0U);
+
+  // Commands run through the shell are recorded too
+  yakka::process_usage shell_usage;
+  EXPECT_EQ(yakka::exec("true | true", "", &shell_usage).second, 0);
+  EXPECT_GT(shell_usage.peak_memory, 0U);
+}
+#endif
@@ -0,0 +1,62 @@
+#include "mpsc_queue.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(MpscQueueTest, PopsInOrder)
+{
+  yakka::mpsc_queue<int> queue;
+  EXPECT_FALSE(queue.pop().has_value());
+  queue.push(1);
+  queue.push(2);
+  EXPECT_EQ(queue.pop(), 1);
+  queue.push(3);
+  EXPECT_EQ(queue.pop(), 2);
+  EXPECT_EQ(queue.pop(), 3);
+  EXPECT_FALSE(queue.pop().has_value());
+}
+
+TEST(MpscQueueTest, ManyProducers)
+{
+  constexpr int producer_count = 4;
+  constexpr int item_count     = 10000;
+  yakka::mpsc_queue<std::pair<int, int>> queue;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < producer_count; ++p)
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < item_count; ++i)
+        queue.push({ p, i });
+    });
+
+  // Each producer's items arrive in the order they were pushed
+  std::vector<int> next(producer_count, 0);
+  int received = 0;
+  while (received < producer_count * item_count) {
+    auto item = queue.pop();
+    if (!item.has_value()) {
+      queue.wait_for(10ms);
+      continue;
+    }
+    EXPECT_EQ(item->second, next[item->first]);
+    next[item->first] = item->second + 1;
+    ++received;
+  }
+  for (auto &producer: producers)
+    producer.join();
+  EXPECT_FALSE(queue.pop().has_value());
+}
+
+TEST(MpscQueueTest, NotifyWakesConsumer)
+{
+  yakka::mpsc_queue<int> queue;
+  std::thread notifier([&queue]() {
+    std::this_thread::sleep_for(50ms);
+    queue.notify();
+  });
+  const auto start = std::chrono::steady_clock::now();
+  queue.wait_for(10s);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+  notifier.join();
+}
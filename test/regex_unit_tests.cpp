@@ -0,0 +1,74 @@
+#include "utilities.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+static std::vector<std::string> all_matches(const std::string &text, const std::string &pattern, int group = 0)
+{
+  std::vector<std::string> result;
+  yakka::for_each_regex_match(text, yakka::cached_regex(pattern), [&](const std::smatch &match) {
+    result.push_back(match[group].str());
+  });
+  return result;
+}
+
+TEST(RegexTest, CachesCompiledRegex)
+{
+  const auto &first  = yakka::cached_regex("([a-z]+)\\.c");
+  const auto &second = yakka::cached_regex("([a-z]+)\\.c");
+  EXPECT_EQ(&first, &second);
+  EXPECT_NE(&first, &yakka::cached_regex("([a-z]+)\\.o"));
+}
+
+TEST(RegexTest, InvalidRegexThrows)
+{
+  EXPECT_THROW(yakka::cached_regex("(unclosed"), std::regex_error);
+  EXPECT_THROW(yakka::cached_regex("(unclosed"), std::regex_error);
+}
+
+TEST(RegexTest, CachesFromManyThreads)
+{
+  std::vector<const std::regex *> regexes(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < regexes.size(); ++i)
+    threads.emplace_back([&, i]() {
+      regexes[i] = &yakka::cached_regex("thread_([0-9]+)");
+    });
+  for (auto &t: threads)
+    t.join();
+  for (const auto r: regexes)
+    EXPECT_EQ(r, regexes[0]);
+}
+
+TEST(RegexTest, IteratesOverMatches)
+{
+  EXPECT_EQ(all_matches("main.c util.c start.s", "([a-z]+)\\.c", 1), (std::vector<std::string>{ "main", "util" }));
+  EXPECT_TRUE(all_matches("nothing here", "[0-9]+").empty());
+}
+
+TEST(RegexTest, AnchorMatchesAtEachSearch)
+{
+  // Matches the behaviour of searching the remaining text after each match
+  EXPECT_EQ(all_matches("aaab", "^a"), (std::vector<std::string>{ "a", "a", "a" }));
+}
+
+TEST(RegexTest, StepsOverEmptyMatches)
+{
+  EXPECT_EQ(all_matches("ab", "x*"), (std::vector<std::string>{ "", "", "" }));
+  EXPECT_EQ(all_matches("", "x*"), (std::vector<std::string>{ "" }));
+}
+
+TEST(RegexTest, LargeInputIsLinear)
+{
+  std::string text;
+  for (int i = 0; i < 50000; ++i)
+    text += "warning: file" + std::to_string(i) + ".c:10: unused variable\n";
+
+  const auto start   = std::chrono::steady_clock::now();
+  const auto matches = all_matches(text, "file([0-9]+)\\.c", 1);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(matches.size(), 50000u);
+  EXPECT_EQ(matches.back(), "49999");
+  EXPECT_LT(elapsed, std::chrono::seconds(10));
+}
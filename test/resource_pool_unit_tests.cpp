@@ -0,0 +1,124 @@
+#include "resource_pool.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <ctime>
+
+using namespace std::chrono_literals;
+
+namespace {
+// Counts the units in use and records the most that were in use at once
+struct usage_monitor {
+  std::atomic<size_t> in_use = 0;
+  std::atomic<size_t> peak   = 0;
+
+  void hold(size_t units, std::chrono::milliseconds duration)
+  {
+    const auto now = in_use += units;
+    for (auto previous = peak.load(); previous < now && !peak.compare_exchange_weak(previous, now);)
+      ;
+    std::this_thread::sleep_for(duration);
+    in_use -= units;
+  }
+};
+} // namespace
+
+TEST(ResourcePoolTest, LimitsConcurrentTasks)
+{
+  yakka::resource_pool pool(2);
+  usage_monitor monitor;
+  tf::Taskflow taskflow;
+  for (int i = 0; i < 6; ++i) {
+    auto task = taskflow.emplace([&]() {
+      monitor.hold(1, 50ms);
+    });
+    EXPECT_EQ(yakka::resource_pool::acquire(taskflow, task, { { &pool, 1 } }), task);
+  }
+  tf::Executor executor(6);
+  executor.run(taskflow).wait();
+  EXPECT_EQ(monitor.peak, 2);
+}
+
+TEST(ResourcePoolTest, WeightedTaskWaitsForAllUnits)
+{
+  yakka::resource_pool pool(4);
+  usage_monitor monitor;
+  tf::Taskflow taskflow;
+  for (int i = 0; i < 4; ++i) {
+    auto task = taskflow.emplace([&]() {
+      monitor.hold(1, 50ms);
+    });
+    yakka::resource_pool::acquire(taskflow, task, { { &pool, 1 } });
+  }
+  for (int i = 0; i < 2; ++i) {
+    auto task  = taskflow.emplace([&]() {
+      monitor.hold(3, 50ms);
+    });
+    auto first = yakka::resource_pool::acquire(taskflow, task, { { &pool, 3 } });
+    EXPECT_NE(first, task);
+  }
+  tf::Executor executor(8);
+  executor.run(taskflow).wait();
+  EXPECT_LE(monitor.peak, 4);
+  EXPECT_EQ(pool.capacity(), 4);
+}
+
+TEST(ResourcePoolTest, WaitingTaskDoesNotSpin)
+{
+  yakka::resource_pool pool(2);
+  tf::Taskflow taskflow;
+  auto holder  = taskflow.emplace([]() {
+    std::this_thread::sleep_for(500ms);
+  });
+  auto started = taskflow.emplace([]() {
+    std::this_thread::sleep_for(50ms);
+  });
+  auto weighted = taskflow.emplace([]() {
+  });
+  yakka::resource_pool::acquire(taskflow, holder, { { &pool, 1 } });
+  started.precede(yakka::resource_pool::acquire(taskflow, weighted, { { &pool, 2 } }));
+
+  tf::Executor executor(4);
+  const auto cpu_start = std::clock();
+  executor.run(taskflow).wait();
+  const auto cpu_seconds = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  EXPECT_LT(cpu_seconds, 0.1);
+}
+
+TEST(ResourcePoolTest, WeightLargerThanPoolIsClamped)
+{
+  yakka::resource_pool pool(2);
+  tf::Taskflow taskflow;
+  bool ran  = false;
+  auto task = taskflow.emplace([&]() {
+    ran = true;
+  });
+  yakka::resource_pool::acquire(taskflow, task, { { &pool, 5 } });
+  tf::Executor executor(2);
+  executor.run(taskflow).wait();
+  EXPECT_TRUE(ran);
+}
+
+TEST(ResourcePoolTest, TasksGatheringSeveralPoolsDoNotDeadlock)
+{
+  yakka::resource_pool first_pool(2);
+  yakka::resource_pool second_pool(2);
+  usage_monitor first_monitor;
+  usage_monitor second_monitor;
+  tf::Taskflow taskflow;
+  for (int i = 0; i < 4; ++i) {
+    const size_t first_units  = i % 2 ? 2 : 1;
+    const size_t second_units = i % 2 ? 1 : 2;
+    auto task                 = taskflow.emplace([&, first_units, second_units]() {
+      std::jthread first([&]() {
+        first_monitor.hold(first_units, 20ms);
+      });
+      second_monitor.hold(second_units, 20ms);
+    });
+    yakka::resource_pool::acquire(taskflow, task, { { &first_pool, first_units }, { &second_pool, second_units } });
+  }
+  tf::Executor executor(4);
+  EXPECT_EQ(executor.run(taskflow).wait_for(10s), std::future_status::ready);
+  EXPECT_LE(first_monitor.peak, 2);
+  EXPECT_LE(second_monitor.peak, 2);
+}
@@ -0,0 +1,72 @@
+#include "stat_cache.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class StatCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    test_dir = fs::temp_directory_path() / "yakka_stat_cache_test";
+    fs::remove_all(test_dir);
+    fs::create_directories(test_dir);
+  }
+
+  void TearDown() override
+  {
+    fs::remove_all(test_dir);
+  }
+
+  void write_file(const fs::path &path, const std::string &content)
+  {
+    std::ofstream file(path, std::ios_base::binary);
+    file << content;
+  }
+
+  fs::path test_dir;
+  yakka::stat_cache cache;
+};
+
+TEST_F(StatCacheTest, MatchesFilesystem)
+{
+  const auto file = (test_dir / "main.c").string();
+  write_file(file, "content");
+
+  const auto status = cache.status(file);
+  EXPECT_TRUE(status.exists);
+  EXPECT_TRUE(status.is_regular_file);
+  EXPECT_EQ(status.size, 7U);
+  EXPECT_EQ(status.last_write_time, fs::last_write_time(file));
+  EXPECT_FALSE(cache.status(test_dir.string()).is_regular_file);
+  EXPECT_FALSE(cache.exists((test_dir / "missing.c").string()));
+  EXPECT_EQ(cache.last_write_time((test_dir / "missing.c").string()), fs::file_time_type::min());
+}
+
+TEST_F(StatCacheTest, InvalidateRereadsFile)
+{
+  const auto file = (test_dir / "main.o").string();
+  EXPECT_FALSE(cache.exists(file));
+
+  write_file(file, "object");
+  EXPECT_FALSE(cache.exists(file));
+  cache.invalidate(file);
+  EXPECT_TRUE(cache.exists(file));
+}
+
+TEST_F(StatCacheTest, PrefetchFillsCache)
+{
+  std::vector<std::string> paths;
+  for (int i = 0; i < 200; ++i) {
+    paths.push_back((test_dir / ("file" + std::to_string(i) + ".h")).string());
+    if (i % 2 == 0)
+      write_file(paths.back(), "header");
+  }
+  cache.prefetch(paths);
+
+  // Remove the files so the results can only come from the cache
+  fs::remove_all(test_dir);
+  for (int i = 0; i < 200; ++i)
+    EXPECT_EQ(cache.exists(paths[i]), i % 2 == 0);
+}
@@ -0,0 +1,131 @@
+#include "task_database.hpp"
+#include "utilities.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class TaskDatabaseTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    test_dir = fs::temp_directory_path() / "yakka_task_database_test";
+    fs::create_directories(test_dir);
+    database_path = (test_dir / "tasks.json").string();
+  }
+
+  void TearDown() override
+  {
+    fs::remove_all(test_dir);
+  }
+
+  void write_file(const fs::path &path, const std::string &content)
+  {
+    std::ofstream file(path, std::ios_base::binary);
+    file << content;
+  }
+
+  fs::path test_dir;
+  std::string database_path;
+};
+
+TEST(HashTest, MatchesReferenceDigest)
+{
+  // Reference values from the XXH64 specification
+  EXPECT_EQ(yakka::hash_bytes(""), 0xEF46DB3751D8E999ULL);
+  EXPECT_EQ(yakka::hash_bytes("", 1), 0xD5AFBA1336A3BE4BULL);
+  EXPECT_EQ(yakka::hash_bytes("abc"), 0x44BC2CF5AD770999ULL);
+  EXPECT_EQ(yakka::hash_bytes("Nobody inspects the spammish repetition"), 0xFBCEA83C8A378BF1ULL);
+}
+
+TEST(HashTest, FileMatchesBytes)
+{
+  // Larger than the chunk the file is read in and not a multiple of the stripe size
+  std::string contents;
+  for (size_t i = 0; i < 200003; ++i)
+    contents.push_back(static_cast<char>(i * 31 + 7));
+  const auto path = fs::temp_directory_path() / "yakka_hash_file_test.bin";
+  std::ofstream(path, std::ios::binary) << contents;
+  EXPECT_EQ(yakka::hash_file(path), yakka::hash_bytes(contents));
+  fs::remove(path);
+  EXPECT_FALSE(yakka::hash_file(path).has_value());
+}
+
+TEST(HashTest, LongInputsDiffer)
+{
+  const std::string a(1000, 'a');
+  std::string b = a;
+  b[999]        = 'b';
+  EXPECT_NE(yakka::hash_bytes(a), yakka::hash_bytes(b));
+  EXPECT_EQ(yakka::hash_bytes(a), yakka::hash_bytes(std::string(1000, 'a')));
+}
+
+TEST(HashTest, DataDependencyDigest)
+{
+  auto summary = R"({ "components": { "a": { "flags": { "c": ["-O2"] } }, "b": { "flags": { "c": ["-g"] } } } })"_json;
+  const auto single   = yakka::hash_data_dependency(":/a/flags/c", summary);
+  const auto wildcard = yakka::hash_data_dependency(":/*/flags/c", summary);
+
+  summary["components"]["b"]["flags"]["c"].push_back("-Wall");
+  EXPECT_EQ(single, yakka::hash_data_dependency(":/a/flags/c", summary));
+  EXPECT_NE(wildcard, yakka::hash_data_dependency(":/*/flags/c", summary));
+}
+
+TEST_F(TaskDatabaseTest, FileDigestTracksContent)
+{
+  const auto file = test_dir / "input.c";
+  write_file(file, "int main(void) { return 0; }");
+
+  yakka::task_database database;
+  const auto first = database.file_digest(file);
+  ASSERT_TRUE(first.has_value());
+
+  // Rewriting identical content produces the same digest even though the timestamp changes
+  write_file(file, "int main(void) { return 0; }");
+  EXPECT_EQ(database.file_digest(file), first);
+
+  write_file(file, "int main(void) { return 1; }");
+  EXPECT_NE(database.file_digest(file), first);
+
+  EXPECT_FALSE(database.file_digest(test_dir / "missing.c").has_value());
+}
+
+TEST_F(TaskDatabaseTest, SaveAndLoad)
+{
+  const auto file = test_dir / "input.c";
+  write_file(file, "content");
+
+  {
+    yakka::task_database database;
+    database.file_digest(file);
+    database.set_input_digest("target", 1234);
+    database.set_command_signature("target", 5678);
+    database.set_command_inputs("target", 9012);
+    database.set_duration("target", 250);
+    database.set_input_time("target", -42);
+    database.set_usage("target", { 2048, 150, 4096, 512 });
+    database.save(database_path);
+  }
+
+  yakka::task_database database;
+  database.load(database_path);
+  EXPECT_EQ(database.get_input_digest("target"), 1234U);
+  EXPECT_FALSE(database.get_input_digest("other").has_value());
+  EXPECT_EQ(database.get_command_signature("target"), 5678U);
+  EXPECT_FALSE(database.get_command_signature("other").has_value());
+  EXPECT_EQ(database.get_command_inputs("target"), 9012U);
+  EXPECT_FALSE(database.get_command_inputs("other").has_value());
+  EXPECT_EQ(database.get_duration("target"), 250U);
+  EXPECT_FALSE(database.get_duration("other").has_value());
+  EXPECT_EQ(database.get_input_time("target"), -42);
+  EXPECT_FALSE(database.get_input_time("other").has_value());
+  const auto usage = database.get_usage("target");
+  ASSERT_TRUE(usage.has_value());
+  EXPECT_EQ(usage->peak_memory, 2048U);
+  EXPECT_EQ(usage->cpu_time, 150U);
+  EXPECT_EQ(usage->read_bytes, 4096U);
+  EXPECT_EQ(usage->write_bytes, 512U);
+  EXPECT_FALSE(database.get_usage("other").has_value());
+  EXPECT_EQ(database.file_digest(file), yakka::hash_bytes("content"));
+}
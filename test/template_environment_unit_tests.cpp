@@ -0,0 +1,153 @@
+#include "template_environment.hpp"
+#include "blueprint_database.hpp"
+#include "yakka_project.hpp"
+#include "yakka_workspace.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+TEST(TemplateEnvironmentTest, ParsesTemplateOnce)
+{
+  auto &env         = yakka::template_environment::get();
+  const auto &first = env.parse_cached("{{ name }}.o");
+  EXPECT_EQ(&env.parse_cached("{{ name }}.o"), &first);
+  EXPECT_EQ(env.render("{{ name }}.o", { { "name", "main" } }), "main.o");
+  EXPECT_EQ(env.render("{{ name }}.o", { { "name", "util" } }), "util.o");
+  EXPECT_EQ(env.render("plain text", {}), "plain text");
+}
+
+TEST(TemplateEnvironmentTest, UsesContextOfThread)
+{
+  auto &env = yakka::template_environment::get();
+  EXPECT_EQ(yakka::try_render(env, "{{ curdir }}", {}), "");
+
+  std::vector<std::thread> threads;
+  std::vector<bool> results(4, false);
+  for (size_t t = 0; t < results.size(); ++t)
+    threads.emplace_back([&, t]() {
+      const auto name = "file" + std::to_string(t);
+      const nlohmann::json summary{ { "suffix", ".o" }, { "inner", "{{ $(1) }}" } };
+      yakka::blueprint_match match;
+      match.regex_matches = { name + ".o", name };
+      yakka::template_context context;
+      context.match   = &match;
+      context.curdir  = "dir" + std::to_string(t);
+      context.summary = &summary;
+      yakka::template_environment::context_scope scope(context);
+
+      bool success = true;
+      for (int i = 0; i < 100; ++i) {
+        success = success && env.render("{{ curdir }}/{{ $(1) }}{{ suffix }}", summary) == context.curdir + "/" + name + ".o";
+        success = success && env.render("{{ render(inner) }}", summary) == name;
+        env.render("{{ store(\"/count\", " + std::to_string(i) + ") }}", summary);
+      }
+      results[t] = success && context.data_store["count"] == 99;
+    });
+  for (auto &t: threads)
+    t.join();
+
+  EXPECT_EQ(results, std::vector<bool>(4, true));
+}
+
+TEST(TemplateEnvironmentTest, ParsesIncludesWhileRendering)
+{
+  auto &env       = yakka::template_environment::get();
+  const auto path = std::filesystem::temp_directory_path() / "yakka_template_includes";
+  std::filesystem::create_directories(path);
+  for (int t = 0; t < 4; ++t)
+    for (int i = 0; i < 50; ++i)
+      std::ofstream(path / (std::to_string(t) + "_" + std::to_string(i) + ".txt")) << t * 100 + i;
+
+  // Each render parses a template whose include adds to the template storage while other threads render includes
+  std::vector<std::thread> threads;
+  std::vector<bool> results(4, false);
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([&, t]() {
+      const nlohmann::json summary;
+      yakka::template_context context;
+      context.summary = &summary;
+      yakka::template_environment::context_scope scope(context);
+
+      bool success = true;
+      for (int i = 0; i < 50; ++i) {
+        const auto include = "{% include \"" + (path / (std::to_string(t) + "_" + std::to_string(i) + ".txt")).generic_string() + "\" %}";
+        const nlohmann::json data{ { "inner", include } };
+        success = success && env.render("{{ render(inner) }}", data) == std::to_string(t * 100 + i);
+      }
+      results[t] = success;
+    });
+  for (auto &t: threads)
+    t.join();
+  std::filesystem::remove_all(path);
+
+  EXPECT_EQ(results, std::vector<bool>(4, true));
+}
+
+TEST(TemplateEnvironmentTest, RendersRegexMatch)
+{
+  auto &env = yakka::template_environment::get();
+  const std::string text{ "key=value" };
+  std::smatch match;
+  ASSERT_TRUE(std::regex_match(text, match, std::regex("(\\w+)=(\\w+)")));
+  yakka::template_context context;
+  context.regex_match = &match;
+  yakka::template_environment::context_scope scope(context);
+  EXPECT_EQ(env.render("{{ reg(2) }}:{{ reg(1) }}", {}), "value:key");
+}
+
+TEST(TemplateEnvironmentTest, ReadsFilesWrittenDuringBuild)
+{
+  auto &env       = yakka::template_environment::get();
+  const auto path = (std::filesystem::temp_directory_path() / "yakka_template_written.txt").generic_string();
+  std::filesystem::remove(path);
+
+  // The stat cache has the file as missing, as it would if a tool wrote it without it being the target of the task
+  yakka::workspace workspace;
+  yakka::project project("test", workspace);
+  EXPECT_FALSE(project.stat_cache.exists(path));
+  std::ofstream(path) << "abc";
+
+  const nlohmann::json data{ { "path", path } };
+  yakka::template_context context;
+  context.project = &project;
+  yakka::template_environment::context_scope scope(context);
+  EXPECT_EQ(env.render("{{ file_exists(path) }} {{ filesize(path) }}", data), "true 3");
+  std::filesystem::remove(path);
+}
+
+TEST(TemplateEnvironmentTest, CachesAggregatesSharedByTasks)
+{
+  auto &env = yakka::template_environment::get();
+  yakka::aggregate_cache aggregates;
+  nlohmann::json summary;
+  summary["name"]                        = "main";
+  summary["components"]["a"]["sources"]  = { "{{ name }}.c" };
+  summary["components"]["b"]["sources"]  = { "util.c" };
+  summary["components"]["a"]["matched"]  = { "{{ $(1) }}.c" };
+  summary["components"]["b"]["settings"] = { { "level", 2 } };
+
+  auto render = [&](const std::string &input, const std::string &capture) {
+    yakka::blueprint_match match;
+    match.regex_matches = { "", capture };
+    yakka::template_context context;
+    context.match      = &match;
+    context.summary    = &summary;
+    context.aggregates = &aggregates;
+    yakka::template_environment::context_scope scope(context);
+    return env.render(input, summary);
+  };
+
+  EXPECT_EQ(render("{% for s in aggregate(\"sources\") %}{{ s }} {% endfor %}", "x"), "main.c util.c ");
+  EXPECT_EQ(render("{{ aggregate(\"settings\").level }}", "x"), "2");
+  summary["components"]["b"]["sources"] = { "other.c" };
+  EXPECT_EQ(render("{% for s in aggregate(\"sources\") %}{{ s }} {% endfor %}", "x"), "main.c util.c ");
+
+  // Aggregates that depend on the match are computed for every task
+  EXPECT_EQ(render("{{ first(aggregate(\"matched\")) }}", "x"), "x.c");
+  EXPECT_EQ(render("{{ first(aggregate(\"matched\")) }}", "y"), "y.c");
+  EXPECT_FALSE(aggregates.find("matched").has_value());
+
+  aggregates.clear();
+  EXPECT_EQ(render("{% for s in aggregate(\"sources\") %}{{ s }} {% endfor %}", "x"), "main.c other.c ");
+}
@@ -0,0 +1,215 @@
+#include "artifact_cache.hpp"
+#include "utilities.hpp"
+#include "spdlog/spdlog.h"
+#include <fstream>
+#include <format>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+namespace yakka {
+static const char *manifest_filename = "manifest.json";
+static const auto stale_age          = std::chrono::minutes(10);
+
+static fs::path unique_temp_path(const fs::path &directory)
+{
+  static std::atomic<uint64_t> counter = 0;
+  std::random_device random;
+  const uint64_t id = hash_combine((static_cast<uint64_t>(random()) << 32) | random(), counter++);
+  return directory / std::format("{:016x}", id);
+}
+
+/**
+ * @brief Copies a file out of the cache. The copy is renamed into place so the destination is never left truncated.
+ */
+static void restore_file(const fs::path &source, const fs::path &destination)
+{
+  if (destination.has_parent_path())
+    fs::create_directories(destination.parent_path());
+  const auto temp_path = destination.string() + ".yakka_tmp";
+  fs::copy_file(source, temp_path, fs::copy_options::overwrite_existing);
+  fs::rename(temp_path, destination);
+}
+
+artifact_cache::artifact_cache() : hits(0), misses(0), stores(0), max_size(0)
+{
+}
+
+void artifact_cache::init(const fs::path &path, uintmax_t max_size)
+{
+  std::error_code ec;
+  fs::create_directories(path / "tmp", ec);
+  if (ec) {
+    spdlog::error("Failed to create artifact cache '{}': {}", path.generic_string(), ec.message());
+    return;
+  }
+  this->cache_path = path;
+  this->max_size   = max_size;
+}
+
+bool artifact_cache::is_enabled() const
+{
+  return !cache_path.empty();
+}
+
+fs::path artifact_cache::entry_path(uint64_t key) const
+{
+  const auto name = std::format("{:016x}", key);
+  return cache_path / name.substr(0, 2) / name;
+}
+
+/**
+ * @brief Restores the target and its dependency files from the cache.
+ *        The entry is only used if every dependency discovered when it was stored still has the same digest.
+ *
+ * @param key               Cache key of the target
+ * @param target            Path the target is restored to
+ * @param dependency_files  Paths the dependency files of the target are restored to
+ * @param file_digest       Returns the current digest of a file
+ * @return true if the target was restored
+ */
+bool artifact_cache::restore(uint64_t key, const std::string &target, const std::vector<std::string> &dependency_files, const std::function<std::optional<uint64_t>(const std::string &)> &file_digest)
+{
+  const auto entry = entry_path(key);
+  try {
+    std::ifstream manifest_file(entry / manifest_filename);
+    if (!manifest_file.is_open()) {
+      ++misses;
+      return false;
+    }
+    const auto manifest = nlohmann::json::parse(manifest_file);
+    manifest_file.close();
+
+    if (manifest["dependency_files"].get<size_t>() != dependency_files.size()) {
+      ++misses;
+      return false;
+    }
+    for (const auto &[path, digest]: manifest["discovered"].items())
+      if (file_digest(path) != digest.get<uint64_t>()) {
+        ++misses;
+        return false;
+      }
+
+    restore_file(entry / "target", target);
+    for (size_t i = 0; i < dependency_files.size(); ++i)
+      restore_file(entry / std::to_string(i), dependency_files[i]);
+
+    // The manifest timestamp records when the entry was last used
+    std::error_code ec;
+    fs::last_write_time(entry / manifest_filename, fs::file_time_type::clock::now(), ec);
+  } catch (std::exception &e) {
+    // Another process may have replaced or evicted the entry while it was being read
+    spdlog::info("Failed to restore {} from the artifact cache: {}", target, e.what());
+    ++misses;
+    return false;
+  }
+
+  ++hits;
+  return true;
+}
+
+/**
+ * @brief Adds the target and its dependency files to the cache, replacing any existing entry for the key.
+ *
+ * @param key               Cache key of the target
+ * @param target            Path of the target
+ * @param dependency_files  Paths of the dependency files written with the target
+ * @param discovered        Map of dependencies found in the dependency files to their digests
+ */
+void artifact_cache::store(uint64_t key, const std::string &target, const std::vector<std::string> &dependency_files, const nlohmann::json &discovered)
+{
+  const auto entry     = entry_path(key);
+  const auto temp_path = unique_temp_path(cache_path / "tmp");
+  std::error_code ec;
+  try {
+    fs::create_directories(temp_path);
+    fs::copy_file(target, temp_path / "target");
+    for (size_t i = 0; i < dependency_files.size(); ++i)
+      fs::copy_file(dependency_files[i], temp_path / std::to_string(i));
+    {
+      std::ofstream manifest_file(temp_path / manifest_filename);
+      manifest_file << nlohmann::json{ { "dependency_files", dependency_files.size() }, { "discovered", discovered } }.dump();
+    }
+
+    fs::create_directories(entry.parent_path());
+    fs::remove_all(entry, ec);
+    fs::rename(temp_path, entry);
+    ++stores;
+  } catch (std::exception &e) {
+    spdlog::info("Failed to store {} in the artifact cache: {}", target, e.what());
+    fs::remove_all(temp_path, ec);
+  }
+}
+
+/**
+ * @brief Evicts the least recently used entries until the cache is within its size limit.
+ *        Only one process trims the cache at a time. The lock is a directory as creating one is atomic on every platform.
+ */
+void artifact_cache::trim()
+{
+  if (!is_enabled())
+    return;
+
+  std::error_code ec;
+  const auto lock_path = cache_path / "lock";
+  const auto now       = fs::file_time_type::clock::now();
+  if (!fs::create_directory(lock_path, ec)) {
+    // Reclaim a lock left behind by a process that did not finish
+    const auto lock_time = fs::last_write_time(lock_path, ec);
+    if (ec || now - lock_time < stale_age)
+      return;
+    fs::last_write_time(lock_path, now, ec);
+  }
+
+  struct entry_info {
+    fs::path path;
+    fs::file_time_type last_used;
+    uintmax_t size;
+  };
+  std::vector<entry_info> entries;
+  uintmax_t total_size = 0;
+
+  for (const auto &bucket: fs::directory_iterator(cache_path, ec)) {
+    const auto bucket_name = bucket.path().filename();
+    if (!bucket.is_directory() || bucket_name == "lock")
+      continue;
+
+    // Remove temporary entries left behind by interrupted stores
+    if (bucket_name == "tmp") {
+      for (const auto &temp: fs::directory_iterator(bucket.path(), ec)) {
+        const auto temp_time = fs::last_write_time(temp.path(), ec);
+        if (!ec && now - temp_time > stale_age)
+          fs::remove_all(temp.path(), ec);
+      }
+      continue;
+    }
+
+    for (const auto &entry: fs::directory_iterator(bucket.path(), ec)) {
+      entry_info info{ entry.path(), fs::last_write_time(entry.path() / manifest_filename, ec), 0 };
+      if (ec)
+        info.last_used = fs::file_time_type::min();
+      for (const auto &file: fs::directory_iterator(entry.path(), ec)) {
+        const auto size = file.file_size(ec);
+        if (!ec)
+          info.size += size;
+      }
+      total_size += info.size;
+      entries.push_back(info);
+    }
+  }
+
+  if (total_size > max_size) {
+    std::sort(entries.begin(), entries.end(), [](const entry_info &a, const entry_info &b) {
+      return a.last_used < b.last_used;
+    });
+    for (const auto &entry: entries) {
+      if (total_size <= max_size)
+        break;
+      fs::remove_all(entry.path, ec);
+      total_size -= entry.size;
+    }
+  }
+
+  fs::remove(lock_path, ec);
+}
+} // namespace yakka
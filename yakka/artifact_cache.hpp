@@ -0,0 +1,40 @@
+#pragma once
+
+#include "json.hpp"
+#include <string>
+#include <vector>
+#include <optional>
+#include <atomic>
+#include <functional>
+#include <filesystem>
+#include <cstdint>
+
+namespace yakka {
+/**
+ * @brief Content-addressed store of blueprint outputs shared by every project using the same Yakka home.
+ *        Entries are keyed on the signature of the rendered process combined with the digests of the declared dependencies.
+ *        Each entry holds the target, the dependency files written alongside it, and a manifest of the digests of the
+ *        dependencies discovered in those files, which must still match before the entry is used.
+ *        Entries are written to a temporary directory and renamed into place so concurrent processes never see a partial entry.
+ */
+class artifact_cache {
+public:
+  artifact_cache();
+  void init(const std::filesystem::path &path, uintmax_t max_size);
+  bool is_enabled() const;
+
+  bool restore(uint64_t key, const std::string &target, const std::vector<std::string> &dependency_files, const std::function<std::optional<uint64_t>(const std::string &)> &file_digest);
+  void store(uint64_t key, const std::string &target, const std::vector<std::string> &dependency_files, const nlohmann::json &discovered);
+  void trim();
+
+  std::atomic<size_t> hits;
+  std::atomic<size_t> misses;
+  std::atomic<size_t> stores;
+
+private:
+  std::filesystem::path entry_path(uint64_t key) const;
+
+  std::filesystem::path cache_path;
+  uintmax_t max_size;
+};
+} // namespace yakka
@@ -1,120 +1,178 @@
 #include "blueprint_database.hpp"
+#include "template_environment.hpp"
 #include "utilities.hpp"
 #include "yakka.hpp"
 #include "inja.hpp"
 #include "glob/glob.h"
 #include "spdlog/spdlog.h"
 #include <regex>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 
 namespace yakka {
-std::vector<std::shared_ptr<blueprint_match>> blueprint_database::find_match(const std::string target, const nlohmann::json &project_summary)
+/**
+ * @brief Finds the literal text that every string matching @p pattern starts and ends with.
+ *        Anything that isn't understood ends the literal text, so the result may be shorter than possible but never wrong.
+ */
+static std::pair<std::string, std::string> literal_affixes(const std::string &pattern)
 {
-  bool blueprint_match_found = false;
-  std::vector<std::shared_ptr<blueprint_match>> result;
+  const int other = -1;
+  std::vector<int> tokens; // Literal characters, or other for anything else
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    const char c = pattern[i];
+    if (c == '|') {
+      // Alternatives don't share any text
+      return {};
+    } else if (c == '\\') {
+      if (i + 1 < pattern.size() && !std::isalnum(static_cast<unsigned char>(pattern[i + 1])))
+        tokens.push_back(static_cast<unsigned char>(pattern[i + 1]));
+      else
+        tokens.push_back(other);
+      ++i;
+    } else if (c == '[') {
+      // Skip the character class
+      size_t end = i + 1;
+      if (end < pattern.size() && pattern[end] == '^')
+        ++end;
+      if (end < pattern.size() && pattern[end] == ']')
+        ++end;
+      while (end < pattern.size() && pattern[end] != ']')
+        end += pattern[end] == '\\' ? 2 : 1;
+      if (end >= pattern.size())
+        return {};
+      tokens.push_back(other);
+      i = end;
+    } else if (c == '*' || c == '+' || c == '?' || c == '{') {
+      // A quantified character may be missing or repeated
+      if (!tokens.empty())
+        tokens.back() = other;
+      tokens.push_back(other);
+      if (c == '{' && (i = pattern.find('}', i)) == std::string::npos)
+        return {};
+    } else if (std::strchr("^$.()", c) != nullptr) {
+      tokens.push_back(other);
+    } else {
+      tokens.push_back(static_cast<unsigned char>(c));
+    }
+  }
 
-  for (const auto &blueprint: blueprints) {
-    auto match = std::make_shared<blueprint_match>();
+  std::string prefix;
+  for (auto t = tokens.begin(); t != tokens.end() && *t != other; ++t)
+    prefix.push_back(static_cast<char>(*t));
+  std::string suffix;
+  for (auto t = tokens.rbegin(); t != tokens.rend() && *t != other; ++t)
+    suffix.insert(suffix.begin(), static_cast<char>(*t));
+  return { prefix, suffix };
+}
 
-    // Check if rule is a regex, otherwise do a string comparison
-    if (blueprint.second->regex.has_value()) {
-      std::smatch s;
-      if (!std::regex_match(target, s, std::regex{ blueprint.first }))
-        continue;
+void blueprint_database::insert(const std::string &target, std::shared_ptr<yakka::blueprint> blueprint)
+{
+  blueprints.insert({ target, blueprint });
+
+  // Parse the templates of the blueprint before they are rendered for every target
+  auto &templates = template_environment::get();
+  for (const auto &d: blueprint->dependencies)
+    templates.preload(d.name);
+  for (const auto &step: blueprint->process)
+    if (step.is_object())
+      for (const auto &[command, value]: step.items())
+        if (value.is_string())
+          templates.preload(value.get<std::string>());
+
+  const size_t sequence = blueprint_count++;
+  if (!blueprint->regex.has_value()) {
+    literal_blueprints[target].push_back({ target, sequence, blueprint });
+    return;
+  }
 
-      // arg_count starts at 0 as the first match is the entire string
-      for (auto &regex_match: s)
-        match->regex_matches.push_back(regex_match.str());
-    } else {
-      if (target != blueprint.first)
-        continue;
+  regex_blueprint entry;
+  entry.target                         = target;
+  entry.sequence                       = sequence;
+  entry.blueprint                      = blueprint;
+  std::tie(entry.prefix, entry.suffix) = literal_affixes(target);
+  try {
+    entry.pattern.emplace(target);
+  } catch (std::regex_error &e) {
+    spdlog::error("Invalid regex in blueprint '{}': {}", target, e.what());
+  }
+  regex_blueprints.push_back(std::move(entry));
+}
+
+std::vector<std::shared_ptr<blueprint_match>> blueprint_database::find_match(const std::string target, const nlohmann::json &project_summary)
+{
+  std::vector<std::shared_ptr<blueprint_match>> result;
 
+  // Find the matching blueprints
+  std::vector<std::pair<const indexed_blueprint *, std::shared_ptr<blueprint_match>>> candidates;
+  const auto literal = literal_blueprints.find(target);
+  if (literal != literal_blueprints.end())
+    for (const auto &b: literal->second) {
+      auto match = std::make_shared<blueprint_match>();
       match->regex_matches.push_back(target);
+      candidates.push_back({ &b, match });
     }
+  for (const auto &b: regex_blueprints) {
+    if (!b.pattern.has_value() || !target.starts_with(b.prefix) || !target.ends_with(b.suffix))
+      continue;
+    std::smatch s;
+    if (!std::regex_match(target, s, b.pattern.value()))
+      continue;
+
+    // arg_count starts at 0 as the first match is the entire string
+    auto match = std::make_shared<blueprint_match>();
+    for (auto &regex_match: s)
+      match->regex_matches.push_back(regex_match.str());
+    candidates.push_back({ &b, match });
+  }
 
-    // Found a match. Create a blueprint match object
-    blueprint_match_found = true;
-    match->blueprint      = blueprint.second;
-
-    inja::Environment local_inja_env;
-
-    add_common_template_commands(local_inja_env);
-
-    local_inja_env.add_callback("$", 1, [&match](const inja::Arguments &args) {
-      const int index = args[0]->get<int>();
-      if (index < match->regex_matches.size())
-        return nlohmann::json(match->regex_matches[index]);
-
-      return nlohmann::json();
-    });
-    local_inja_env.add_callback("curdir", 0, [&match](const inja::Arguments &args) {
-      return match->blueprint->parent_path;
-    });
-    local_inja_env.add_callback("render", 1, [&](const inja::Arguments &args) {
-      return local_inja_env.render(args[0]->get<std::string>(), project_summary);
-    });
-    local_inja_env.add_callback("select", 1, [&](const inja::Arguments &args) {
-      nlohmann::json choice;
-      for (const auto &option: args.at(0)->items()) {
-        const auto option_type = option.key();
-        const auto option_name = option.value();
-        if ((option_type == "feature" && project_summary["features"].contains(option_name)) || (option_type == "component" && project_summary["components"].contains(option_name))) {
-          assert(choice.is_null());
-          choice = option_name;
-        }
-      }
-      return choice;
-    });
-    local_inja_env.add_callback("aggregate", 1, [&](const inja::Arguments &args) {
-      nlohmann::json aggregate;
-      auto path = json_pointer(args[0]->get<std::string>());
-      // Loop through components, check if object path exists, if so add it to the aggregate
-      for (const auto &[c_key, c_value]: project_summary["components"].items()) {
-        // auto v = json_path(c.value(), path);
-        if (!c_value.contains(path))
-          continue;
+  // Keep the order of the blueprint map
+  std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) {
+    return std::tie(a.first->target, a.first->sequence) < std::tie(b.first->target, b.first->sequence);
+  });
 
-        auto v = c_value[path];
-        if (v.is_object())
-          for (const auto &[i_key, i_value]: v.items())
-            aggregate[i_key] = i_value; //local_inja_env.render(i.second.as<std::string>(), this->project_summary);
-        else if (v.is_array())
-          for (const auto &i: v)
-            aggregate.push_back(local_inja_env.render(i.get<std::string>(), project_summary));
-        else
-          aggregate.push_back(local_inja_env.render(v.get<std::string>(), project_summary));
-      }
+  for (const auto &[entry, candidate]: candidates) {
+    // Found a match. Create a blueprint match object
+    auto match       = candidate;
+    match->blueprint = entry->blueprint;
 
-      // Check project data
-      if (project_summary["data"].contains(path)) {
-        auto v = project_summary["data"][path];
-        if (v.is_object())
-          for (const auto &[i_key, i_value]: v.items())
-            aggregate[i_key] = i_value;
-        else if (v.is_array())
-          for (const auto &i: v)
-            aggregate.push_back(local_inja_env.render(i.get<std::string>(), project_summary));
-        else
-          aggregate.push_back(local_inja_env.render(v.get<std::string>(), project_summary));
-      }
-      return aggregate;
-    });
+    template_context context;
+    context.match      = match.get();
+    context.curdir     = match->blueprint->parent_path;
+    context.summary    = &project_summary;
+    context.aggregates = aggregate_cache;
+    template_environment::context_scope context_scope(context);
+    auto &inja_env = template_environment::get();
 
     // Run template engine on dependencies
-    for (auto d: blueprint.second->dependencies) {
+    for (auto d: entry->blueprint->dependencies) {
       switch (d.type) {
         case blueprint::dependency::DEPENDENCY_FILE_DEPENDENCY: {
-          const std::string generated_dependency_file = yakka::try_render(local_inja_env, d.name, project_summary);
-          auto dependencies                           = parse_gcc_dependency_file(generated_dependency_file);
+          const std::string generated_dependency_file = yakka::try_render(inja_env, d.name, project_summary);
+          auto dependencies                           = deps_log ? deps_log->dependencies(generated_dependency_file) : parse_gcc_dependency_file(generated_dependency_file);
           match->dependencies.insert(std::end(match->dependencies), std::begin(dependencies), std::end(dependencies));
+          match->dependency_files.push_back(generated_dependency_file);
           continue;
         }
         case blueprint::dependency::DATA_DEPENDENCY: {
-          std::string data_name = yakka::try_render(local_inja_env, d.name, project_summary);
+          std::string data_name = yakka::try_render(inja_env, d.name, project_summary);
           if (data_name.front() != yakka::data_dependency_identifier)
             data_name.insert(0, 1, yakka::data_dependency_identifier);
           match->dependencies.push_back(data_name);
           continue;
         }
+        case blueprint::dependency::LIST_DEPENDENCY: {
+          std::vector<std::string> items;
+          try {
+            items = inja_env.render_list(d.name, project_summary);
+          } catch (std::exception &e) {
+            spdlog::error("Error evaluating dependency for {}\r\nCouldn't apply template: '{}'\n{}", entry->target, d.name, e.what());
+            return result;
+          }
+          for (const auto &item: items)
+            match->dependencies.push_back(item.starts_with("./") ? item.substr(item.find_first_not_of("/", 2)) : item);
+          continue;
+        }
         default:
           break;
       }
@@ -122,24 +180,28 @@ std::vector<std::shared_ptr<blueprint_match>> blueprint_database::find_match(con
       // Generate full dependency string by applying template engine
       std::string generated_depend;
       try {
-        generated_depend = local_inja_env.render(d.name, project_summary);
+        generated_depend = inja_env.render(d.name, project_summary);
       } catch (std::exception &e) {
-        spdlog::error("Error evaluating dependency for {}\r\nCouldn't apply template: '{}'\n{}", blueprint.first, d.name, e.what());
+        spdlog::error("Error evaluating dependency for {}\r\nCouldn't apply template: '{}'\n{}", entry->target, d.name, e.what());
         return result;
       }
 
       // Check if the input was a YAML array construct
       if (generated_depend.front() == '[' && generated_depend.back() == ']') {
-        // Load the generated dependency string as YAML and push each item individually
-        try {
-          auto generated_node = YAML::Load(generated_depend);
-          for (auto i: generated_node) {
-            auto temp = i.Scalar();
-            match->dependencies.push_back(temp.starts_with("./") ? temp.substr(temp.find_first_not_of("/", 2)) : temp);
+        auto items = parse_flow_sequence(generated_depend);
+        if (!items.has_value()) {
+          // Load the generated dependency string as YAML and push each item individually
+          items.emplace();
+          try {
+            auto generated_node = YAML::Load(generated_depend);
+            for (auto i: generated_node)
+              items->push_back(i.Scalar());
+          } catch (std::exception &e) {
+            std::cerr << "Failed to parse dependency: " << d.name << "\n";
           }
-        } catch (std::exception &e) {
-          std::cerr << "Failed to parse dependency: " << d.name << "\n";
         }
+        for (const auto &temp: items.value())
+          match->dependencies.push_back(temp.starts_with("./") ? temp.substr(temp.find_first_not_of("/", 2)) : temp);
       } else {
         match->dependencies.push_back(generated_depend.starts_with("./") ? generated_depend.substr(generated_depend.find_first_not_of("/", 2)) : generated_depend);
       }
@@ -149,7 +211,7 @@ std::vector<std::shared_ptr<blueprint_match>> blueprint_database::find_match(con
     // return match;
   }
 
-  if (!blueprint_match_found) {
+  if (candidates.empty()) {
     if (!fs::exists(target))
       spdlog::info("No blueprint for '{}'", target);
   }
@@ -1,28 +1,60 @@
 #pragma once
 
 #include "yakka_blueprint.hpp"
+#include "deps_log.hpp"
+#include "template_environment.hpp"
 #include <string>
 #include <vector>
 #include <memory>
 #include <map>
+#include <unordered_map>
+#include <optional>
+#include <regex>
 
 namespace yakka {
 struct blueprint_match {
   std::vector<std::string> dependencies; // Template processed dependencies
+  std::vector<std::string> dependency_files; // Template processed dependency files
   std::shared_ptr<yakka::blueprint> blueprint;
   std::vector<std::string> regex_matches; // Regex capture groups for a particular regex match
 };
 
+/**
+ * @brief Blueprints of a project and an index used to find the blueprints of a target.
+ *        Literal blueprints are found with a hash lookup. Regex blueprints are compiled once when they are inserted and
+ *        are only tried on targets that start and end with the literal text of their regex.
+ *        Matching doesn't change the database, so find_match can be called from several threads as long as no blueprints
+ *        are inserted at the same time.
+ */
 class blueprint_database {
 public:
   void load(const std::string path);
   void save(const std::string path);
+  void insert(const std::string &target, std::shared_ptr<yakka::blueprint> blueprint);
   std::vector<std::shared_ptr<blueprint_match>> find_match(const std::string target, const nlohmann::json &project_summary);
 
   // void generate_task_database(std::vector<std::string> command_list);
   // void process_blueprint_target( const std::string target );
 
   std::multimap<std::string, std::shared_ptr<blueprint>> blueprints;
+  yakka::deps_log *deps_log               = nullptr; // Dependency files are parsed directly when there is no log
+  yakka::aggregate_cache *aggregate_cache = nullptr; // Aggregates are computed for every match when there is no cache
+
+private:
+  struct indexed_blueprint {
+    std::string target;
+    size_t sequence; // Insertion order, which orders blueprints with the same target
+    std::shared_ptr<yakka::blueprint> blueprint;
+  };
+  struct regex_blueprint : indexed_blueprint {
+    std::optional<std::regex> pattern; // Empty if the regex is invalid
+    std::string prefix;
+    std::string suffix;
+  };
+
+  std::unordered_map<std::string, std::vector<indexed_blueprint>> literal_blueprints;
+  std::vector<regex_blueprint> regex_blueprints;
+  size_t blueprint_count = 0;
 };
 
 class target_database {
@@ -0,0 +1,69 @@
+#include "build_trace.hpp"
+#include "spdlog/spdlog.h"
+#include <fstream>
+#include <format>
+
+namespace yakka {
+build_trace::scope::scope(build_trace &trace, const std::string &name, const char *category) : trace(trace), category(category), start(clock::now())
+{
+  if (trace.is_enabled())
+    this->name = name;
+}
+
+build_trace::scope::~scope()
+{
+  if (trace.is_enabled())
+    trace.add_event(name, category, start, clock::now(), args);
+}
+
+build_trace::build_trace() : enabled(false), events(nlohmann::json::array())
+{
+}
+
+/**
+ * @brief Starts recording. Event timestamps are relative to this call.
+ */
+void build_trace::enable()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  enabled    = true;
+  start_time = clock::now();
+}
+
+bool build_trace::is_enabled() const
+{
+  return enabled;
+}
+
+void build_trace::add_event(const std::string &name, const char *category, clock::time_point start, clock::time_point end, const nlohmann::json &args)
+{
+  const auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(start - start_time).count();
+  const auto duration  = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+  std::lock_guard<std::mutex> guard(lock);
+  // Threads are numbered in the order they first record an event so each worker gets a stable, readable track
+  auto [thread, inserted] = thread_ids.insert({ std::this_thread::get_id(), thread_ids.size() + 1 });
+  if (inserted)
+    events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", thread->second }, { "args", { { "name", std::format("Worker {}", thread->second) } } } });
+
+  nlohmann::json event = { { "name", name }, { "cat", category }, { "ph", "X" }, { "ts", timestamp }, { "dur", duration }, { "pid", 1 }, { "tid", thread->second } };
+  if (!args.is_null())
+    event["args"] = args;
+  events.push_back(std::move(event));
+}
+
+/**
+ * @brief Writes the recorded events as a Trace Event Format JSON file
+ */
+bool build_trace::save(const std::filesystem::path &path)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::ofstream trace_file(path, std::ios_base::binary);
+  if (!trace_file.is_open()) {
+    spdlog::error("Failed to save trace: '{}'", path.generic_string());
+    return false;
+  }
+  trace_file << nlohmann::json{ { "traceEvents", events }, { "displayTimeUnit", "ms" } }.dump();
+  return true;
+}
+} // namespace yakka
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "json.hpp"
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <filesystem>
+
+namespace yakka {
+/**
+ * @brief Records the tasks of a build in the Trace Event Format used by chrome://tracing and Perfetto.
+ *        Each task is a complete event on the track of the thread that ran it. Nothing is recorded until the trace is enabled.
+ */
+class build_trace {
+public:
+  using clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Records an event covering the lifetime of the scope. Arguments added to @ref args are stored with the event.
+   */
+  class scope {
+  public:
+    scope(build_trace &trace, const std::string &name, const char *category);
+    scope(const scope &)            = delete;
+    scope &operator=(const scope &) = delete;
+    ~scope();
+
+    nlohmann::json args;
+
+  private:
+    build_trace &trace;
+    std::string name;
+    const char *category;
+    clock::time_point start;
+  };
+
+  build_trace();
+  void enable();
+  bool is_enabled() const;
+  void add_event(const std::string &name, const char *category, clock::time_point start, clock::time_point end, const nlohmann::json &args);
+  bool save(const std::filesystem::path &path);
+
+private:
+  std::mutex lock;
+  bool enabled;
+  clock::time_point start_time;
+  nlohmann::json events;
+  std::unordered_map<std::thread::id, size_t> thread_ids;
+};
+} // namespace yakka
@@ -0,0 +1,260 @@
+#include "deps_log.hpp"
+#include "utilities.hpp"
+#include "spdlog/spdlog.h"
+#include <cstring>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+namespace yakka {
+// The log starts with a signature and a version. Each record is a 32 bit header holding the size of its payload, with the
+// top bit set for dependency records. A path record holds the path padded to 4 bytes followed by the inverse of its id.
+// A dependency record holds the id of the dependency file, its timestamp and the ids of its dependencies
+static const char log_signature[]             = "# yakka deps\n";
+static const uint32_t log_version             = 1;
+static const uint32_t dependency_record_flag  = 0x80000000;
+static const uint32_t max_record_size         = 64 * 1024 * 1024;
+static const size_t header_size               = sizeof(log_signature) - 1 + sizeof(log_version);
+static const size_t minimum_compaction_record = 1000;
+
+template<typename T> static T read_value(const char *data)
+{
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+deps_log::deps_log() : log_file(nullptr), record_count(0)
+{
+}
+
+deps_log::~deps_log()
+{
+  close();
+}
+
+/**
+ * @brief Loads the log at @p path and appends further records to it.
+ *        A log with a different version is discarded and a truncated record at the end of the log is removed.
+ */
+void deps_log::open(const std::string &path)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  close_file();
+  log_path = path;
+  paths.clear();
+  path_ids.clear();
+  records.clear();
+  record_count = 0;
+
+  // Read the whole log at once
+  std::vector<char> contents;
+  std::error_code ec;
+  const auto file_size = fs::file_size(path, ec);
+  if (!ec && file_size > 0) {
+    contents.resize(file_size);
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr || std::fread(contents.data(), 1, contents.size(), file) != contents.size())
+      contents.clear();
+    if (file != nullptr)
+      std::fclose(file);
+  }
+
+  size_t valid_size = 0;
+  if (contents.size() >= header_size && std::memcmp(contents.data(), log_signature, sizeof(log_signature) - 1) == 0
+      && read_value<uint32_t>(contents.data() + sizeof(log_signature) - 1) == log_version) {
+    valid_size    = header_size;
+    size_t offset = header_size;
+    while (offset + sizeof(uint32_t) <= contents.size()) {
+      const auto header   = read_value<uint32_t>(contents.data() + offset);
+      const auto size     = header & ~dependency_record_flag;
+      const char *payload = contents.data() + offset + sizeof(uint32_t);
+      if (size % 4 != 0 || size > max_record_size || offset + sizeof(uint32_t) + size > contents.size())
+        break;
+
+      if (header & dependency_record_flag) {
+        if (size < sizeof(uint32_t) + sizeof(int64_t))
+          break;
+        const auto file_id = read_value<uint32_t>(payload);
+        deps_log::record entry{ read_value<int64_t>(payload + sizeof(uint32_t)), {} };
+        for (size_t i = sizeof(uint32_t) + sizeof(int64_t); i < size; i += sizeof(uint32_t))
+          entry.dependencies.push_back(read_value<uint32_t>(payload + i));
+        if (file_id >= paths.size() || std::any_of(entry.dependencies.begin(), entry.dependencies.end(), [&](uint32_t id) {
+              return id >= paths.size();
+            }))
+          break;
+        records[file_id] = std::move(entry);
+        ++record_count;
+      } else {
+        if (size < sizeof(uint32_t))
+          break;
+        std::string_view path_view(payload, size - sizeof(uint32_t));
+        while (!path_view.empty() && path_view.back() == '\0')
+          path_view.remove_suffix(1);
+        if (read_value<uint32_t>(payload + size - sizeof(uint32_t)) != ~static_cast<uint32_t>(paths.size()))
+          break;
+        path_ids[std::string(path_view)] = static_cast<uint32_t>(paths.size());
+        paths.emplace_back(path_view);
+      }
+      offset += sizeof(uint32_t) + size;
+      valid_size = offset;
+    }
+  }
+
+  // Rewrite the log once most of it has been replaced by newer records
+  if (record_count > minimum_compaction_record && record_count > 3 * records.size()) {
+    recompact();
+    return;
+  }
+
+  if (valid_size == 0) {
+    log_file = std::fopen(path.c_str(), "wb");
+    if (log_file == nullptr || std::fwrite(log_signature, 1, sizeof(log_signature) - 1, log_file) != sizeof(log_signature) - 1
+        || std::fwrite(&log_version, sizeof(log_version), 1, log_file) != 1) {
+      spdlog::info("Cannot write dependency log '{}'", path);
+      close_file();
+      return;
+    }
+  } else {
+    if (valid_size < contents.size())
+      fs::resize_file(path, valid_size, ec);
+    log_file = std::fopen(path.c_str(), "ab");
+  }
+  if (log_file != nullptr)
+    std::fflush(log_file);
+}
+
+void deps_log::close()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  close_file();
+}
+
+void deps_log::close_file()
+{
+  if (log_file != nullptr)
+    std::fclose(log_file);
+  log_file = nullptr;
+}
+
+/**
+ * @brief Returns the dependencies listed in a dependency file.
+ *        The file is only parsed if it changed since it was recorded in the log.
+ */
+std::vector<std::string> deps_log::dependencies(const std::string &dependency_file)
+{
+  std::error_code ec;
+  const auto last_write_time = fs::last_write_time(dependency_file, ec);
+  if (ec)
+    return {};
+  const int64_t timestamp = last_write_time.time_since_epoch().count();
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    const auto id = path_ids.find(dependency_file);
+    if (id != path_ids.end()) {
+      const auto entry = records.find(id->second);
+      if (entry != records.end() && timestamp <= entry->second.last_write_time) {
+        std::vector<std::string> result;
+        result.reserve(entry->second.dependencies.size());
+        for (const auto dependency: entry->second.dependencies)
+          result.push_back(paths[dependency]);
+        return result;
+      }
+    }
+  }
+
+  return parse(dependency_file, timestamp);
+}
+
+std::vector<std::string> deps_log::parse(const std::string &dependency_file, int64_t last_write_time)
+{
+  auto result = parse_gcc_dependency_file(dependency_file);
+
+  std::lock_guard<std::mutex> guard(lock);
+  const auto file_id = intern(dependency_file);
+  record entry{ last_write_time, {} };
+  entry.dependencies.reserve(result.size());
+  for (const auto &dependency: result)
+    entry.dependencies.push_back(intern(dependency));
+  if (write_record(file_id, entry))
+    ++record_count;
+  records[file_id] = std::move(entry);
+  return result;
+}
+
+uint32_t deps_log::intern(const std::string &path)
+{
+  const auto [id, inserted] = path_ids.insert({ path, static_cast<uint32_t>(paths.size()) });
+  if (inserted) {
+    paths.push_back(path);
+    write_path(path);
+  }
+  return id->second;
+}
+
+bool deps_log::write_path(const std::string &path)
+{
+  if (log_file == nullptr)
+    return false;
+  const uint32_t padding  = (4 - path.size() % 4) % 4;
+  const uint32_t size     = static_cast<uint32_t>(path.size()) + padding + sizeof(uint32_t);
+  const uint32_t checksum = ~static_cast<uint32_t>(paths.size() - 1);
+  const char zeros[4]     = {};
+  bool success            = std::fwrite(&size, sizeof(size), 1, log_file) == 1;
+  success                 = success && std::fwrite(path.data(), 1, path.size(), log_file) == path.size();
+  success                 = success && std::fwrite(zeros, 1, padding, log_file) == padding;
+  success                 = success && std::fwrite(&checksum, sizeof(checksum), 1, log_file) == 1;
+  return success && std::fflush(log_file) == 0;
+}
+
+bool deps_log::write_record(uint32_t file_id, const record &entry)
+{
+  if (log_file == nullptr)
+    return false;
+  const uint32_t header = dependency_record_flag | static_cast<uint32_t>(sizeof(uint32_t) + sizeof(int64_t) + entry.dependencies.size() * sizeof(uint32_t));
+  bool success          = std::fwrite(&header, sizeof(header), 1, log_file) == 1;
+  success               = success && std::fwrite(&file_id, sizeof(file_id), 1, log_file) == 1;
+  success               = success && std::fwrite(&entry.last_write_time, sizeof(entry.last_write_time), 1, log_file) == 1;
+  success               = success && std::fwrite(entry.dependencies.data(), sizeof(uint32_t), entry.dependencies.size(), log_file) == entry.dependencies.size();
+  return success && std::fflush(log_file) == 0;
+}
+
+/**
+ * @brief Writes a new log holding only the latest record of each dependency file and the paths they use
+ */
+void deps_log::recompact()
+{
+  const auto old_paths   = std::move(paths);
+  const auto old_records = std::move(records);
+  paths.clear();
+  path_ids.clear();
+  records.clear();
+  record_count = 0;
+
+  const auto temp_path = log_path + ".tmp";
+  log_file             = std::fopen(temp_path.c_str(), "wb");
+  if (log_file != nullptr) {
+    std::fwrite(log_signature, 1, sizeof(log_signature) - 1, log_file);
+    std::fwrite(&log_version, sizeof(log_version), 1, log_file);
+  }
+  for (const auto &[file_id, old_entry]: old_records) {
+    record entry{ old_entry.last_write_time, {} };
+    const auto new_file_id = intern(old_paths[file_id]);
+    for (const auto dependency: old_entry.dependencies)
+      entry.dependencies.push_back(intern(old_paths[dependency]));
+    if (write_record(new_file_id, entry))
+      ++record_count;
+    records[new_file_id] = std::move(entry);
+  }
+  close_file();
+
+  std::error_code ec;
+  fs::rename(temp_path, log_path, ec);
+  if (ec) {
+    spdlog::info("Cannot compact dependency log '{}': {}", log_path, ec.message());
+    return;
+  }
+  log_file = std::fopen(log_path.c_str(), "ab");
+}
+} // namespace yakka
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdio>
+#include <cstdint>
+
+namespace yakka {
+/**
+ * @brief Binary log of the dependencies listed in the dependency files written by compilers, in the spirit of .ninja_deps.
+ *        Paths are interned and written once. Each dependency file is recorded with its timestamp and the ids of its
+ *        dependencies, and newer records of the same file replace older ones. The log is read with a single read and
+ *        records are appended as dependency files are parsed, so a dependency file is only parsed again once it changes.
+ *        All accessors are thread-safe as they are called from taskflow worker threads.
+ */
+class deps_log {
+public:
+  deps_log();
+  deps_log(const deps_log &)            = delete;
+  deps_log &operator=(const deps_log &) = delete;
+  ~deps_log();
+
+  void open(const std::string &path);
+  void close();
+  std::vector<std::string> dependencies(const std::string &dependency_file);
+
+private:
+  struct record {
+    int64_t last_write_time;
+    std::vector<uint32_t> dependencies;
+  };
+
+  std::vector<std::string> parse(const std::string &dependency_file, int64_t last_write_time);
+  uint32_t intern(const std::string &path);
+  bool write_path(const std::string &path);
+  bool write_record(uint32_t file_id, const record &entry);
+  void recompact();
+  void close_file();
+
+  std::mutex lock;
+  std::string log_path;
+  std::FILE *log_file;
+  std::vector<std::string> paths;
+  std::unordered_map<std::string, uint32_t> path_ids;
+  std::unordered_map<uint32_t, record> records;
+  size_t record_count; // Records in the log file, including the ones that have been replaced
+};
+} // namespace yakka
@@ -0,0 +1,327 @@
+#include "directory_cache.hpp"
+#include "stat_cache.hpp"
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+
+namespace fs = std::filesystem;
+
+namespace yakka {
+// Directories of a recursive walk are read in parallel once a level of the tree holds enough of them
+static const size_t max_walk_threads       = 16;
+static const size_t directories_per_thread = 16;
+// A directory changed this recently could change again within the resolution of its timestamp, so it is not cached
+static const auto racy_interval = std::chrono::seconds(2);
+
+static bool has_magic(std::string_view pattern)
+{
+  return pattern.find_first_of("*?[") != std::string_view::npos;
+}
+
+static bool is_separator(char c)
+{
+#if defined(_WIN64) || defined(_WIN32) || defined(__CYGWIN__)
+  return c == '/' || c == '\\';
+#else
+  return c == '/';
+#endif
+}
+
+static std::string join(const std::string &directory, std::string_view name)
+{
+  if (directory.empty())
+    return std::string(name);
+  if (is_separator(directory.back()))
+    return directory + std::string(name);
+  return directory + "/" + std::string(name);
+}
+
+/**
+ * @brief Matches @p c against the character set of a pattern, such as `[a-z]` or `[!0-9]`
+ *
+ * @param start  Position in @p pattern after the opening bracket
+ * @return size_t  Position after the closing bracket or npos if the set is not closed
+ */
+static size_t match_set(char c, std::string_view pattern, size_t start, bool &matched)
+{
+  size_t i          = start;
+  const bool negate = i < pattern.size() && pattern[i] == '!';
+  if (negate)
+    ++i;
+
+  matched    = false;
+  bool first = true;
+  // A closing bracket straight after the opening bracket is part of the set
+  while (i < pattern.size() && (pattern[i] != ']' || first)) {
+    first          = false;
+    const char low = pattern[i];
+    char high      = low;
+    if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+      high = pattern[i + 2];
+      i += 3;
+    } else {
+      ++i;
+    }
+    if (low <= c && c <= high)
+      matched = true;
+  }
+  if (i >= pattern.size())
+    return std::string_view::npos;
+  matched = matched != negate;
+  return i + 1;
+}
+
+directory_cache &directory_cache::get()
+{
+  static directory_cache cache;
+  return cache;
+}
+
+/**
+ * @brief Matches a file name against a pattern of `*`, `?` and `[...]` wildcards.
+ *        Backtracks only to the last `*`, so matching is linear in practice and needs no regex.
+ */
+bool directory_cache::match(std::string_view name, std::string_view pattern)
+{
+  size_t n           = 0;
+  size_t p           = 0;
+  size_t star        = std::string_view::npos;
+  size_t star_letter = 0;
+  while (n < name.size()) {
+    bool advanced = false;
+    if (p < pattern.size()) {
+      if (pattern[p] == '*') {
+        star        = ++p;
+        star_letter = n;
+        continue;
+      }
+      if (pattern[p] == '[') {
+        bool matched;
+        const auto next = match_set(name[n], pattern, p + 1, matched);
+        if (next != std::string_view::npos) {
+          advanced = matched;
+          p        = matched ? next : p;
+        } else if (name[n] == '[') {
+          // An unclosed bracket is a literal character
+          advanced = true;
+          ++p;
+        }
+      } else if (pattern[p] == '?' || pattern[p] == name[n]) {
+        advanced = true;
+        ++p;
+      }
+    }
+    if (advanced) {
+      ++n;
+      continue;
+    }
+    if (star == std::string_view::npos)
+      return false;
+    p = star;
+    n = ++star_letter;
+  }
+  while (p < pattern.size() && pattern[p] == '*')
+    ++p;
+  return p == pattern.size();
+}
+
+/**
+ * @brief Returns the entries of a directory, reading the directory only if it changed since it was last listed.
+ *        A directory that does not exist has no entries.
+ */
+std::shared_ptr<const directory_cache::listing> directory_cache::list(const std::string &directory)
+{
+  std::string key = directory.empty() ? "." : directory;
+  while (key.size() > 1 && is_separator(key.back()))
+    key.pop_back();
+
+  const auto status = stat_cache::read_status(key);
+  if (!status.exists) {
+    std::unique_lock<std::shared_mutex> guard(lock);
+    listings.erase(key);
+    uncached_listings.insert_or_assign(key, fs::file_time_type::min());
+    return std::make_shared<const listing>();
+  }
+  {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    const auto cached = listings.find(key);
+    if (cached != listings.end() && cached->second->last_write_time == status.last_write_time)
+      return cached->second;
+  }
+
+  // The timestamp is read before the directory so a change made while reading is picked up by the next listing
+  auto result = read_listing(key, status.last_write_time);
+  std::unique_lock<std::shared_mutex> guard(lock);
+  if (fs::file_time_type::clock::now() - status.last_write_time < racy_interval) {
+    listings.erase(key);
+    uncached_listings.insert_or_assign(key, status.last_write_time);
+  } else {
+    uncached_listings.erase(key);
+    listings.insert_or_assign(key, result);
+  }
+  return result;
+}
+
+std::shared_ptr<const directory_cache::listing> directory_cache::read_listing(const std::string &directory, fs::file_time_type last_write_time)
+{
+  auto result             = std::make_shared<listing>();
+  result->last_write_time = last_write_time;
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(directory, fs::directory_options::skip_permission_denied, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    std::error_code type_ec;
+    result->entries.push_back({ it->path().filename().string(), it->is_directory(type_ec) });
+  }
+  std::sort(result->entries.begin(), result->entries.end(), [](const entry &a, const entry &b) {
+    return a.name < b.name;
+  });
+  return result;
+}
+
+/**
+ * @brief Returns every directory below @p directories and, if @p include_files is set, every file.
+ *        Hidden entries are skipped. Each level of the tree is listed in parallel when it is large enough.
+ */
+std::vector<std::string> directory_cache::walk(const std::vector<std::string> &directories, bool include_files)
+{
+  std::vector<std::string> result;
+  std::vector<std::string> level = directories;
+  while (!level.empty()) {
+    std::vector<std::shared_ptr<const listing>> level_listings(level.size());
+    const size_t thread_count = std::clamp<size_t>(level.size() / directories_per_thread, 1, std::min<size_t>(max_walk_threads, std::max(1U, std::thread::hardware_concurrency())));
+    if (thread_count == 1) {
+      for (size_t i = 0; i < level.size(); ++i)
+        level_listings[i] = list(level[i]);
+    } else {
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < thread_count; ++t)
+        threads.emplace_back([&, t]() {
+          for (size_t i = t; i < level.size(); i += thread_count)
+            level_listings[i] = list(level[i]);
+        });
+      for (auto &thread: threads)
+        thread.join();
+    }
+
+    std::vector<std::string> next_level;
+    for (size_t i = 0; i < level.size(); ++i)
+      for (const auto &e: level_listings[i]->entries) {
+        if (e.name.starts_with('.'))
+          continue;
+        auto path = join(level[i], e.name);
+        if (e.is_directory)
+          next_level.push_back(path);
+        if (e.is_directory || include_files)
+          result.push_back(std::move(path));
+      }
+    level = std::move(next_level);
+  }
+  return result;
+}
+
+/**
+ * @brief Expands a glob pattern using the cached directory listings.
+ *        Wildcards match within a path segment and `**` matches one or more levels of directories, or every file and
+ *        directory below when it is the last segment. Names starting with '.' are only matched by patterns starting with
+ *        '.' and are never walked by `**`. A pattern ending with a separator only matches directories.
+ *
+ * @return std::vector<std::string>  The matching paths in sorted order, or the pattern itself if it has no wildcards
+ *                                   and the path exists
+ */
+std::vector<std::string> directory_cache::glob(const std::string &pattern)
+{
+  std::string path = pattern;
+  if (path.starts_with('~')) {
+    const char *home = std::getenv("HOME");
+    if (home != nullptr)
+      path = home + path.substr(1);
+  }
+
+  if (!has_magic(path)) {
+    std::error_code ec;
+    if (fs::exists(path, ec))
+      return { path };
+    return {};
+  }
+
+  // The segments before the first wildcard form the directory the search starts from
+  size_t base_size = path.find_first_of("*?[");
+  while (base_size > 0 && !is_separator(path[base_size - 1]))
+    --base_size;
+  std::vector<std::string_view> segments;
+  const std::string_view remainder = std::string_view(path).substr(base_size);
+  for (size_t start = 0; start < remainder.size();) {
+    size_t end = start;
+    while (end < remainder.size() && !is_separator(remainder[end]))
+      ++end;
+    if (end > start)
+      segments.push_back(remainder.substr(start, end - start));
+    start = end + 1;
+  }
+  const bool directories_only = is_separator(path.back());
+
+  std::vector<std::string> current = { path.substr(0, base_size) };
+  for (size_t i = 0; i < segments.size() && !current.empty(); ++i) {
+    const auto segment        = segments[i];
+    const bool want_directory = i + 1 < segments.size() || directories_only;
+    std::vector<std::string> next;
+    if (segment == "**") {
+      next = walk(current, !want_directory);
+    } else if (!has_magic(segment)) {
+      for (const auto &directory: current) {
+        auto candidate = join(directory, segment);
+        std::error_code ec;
+        if (want_directory ? fs::is_directory(candidate, ec) : fs::exists(candidate, ec))
+          next.push_back(std::move(candidate));
+      }
+    } else {
+      for (const auto &directory: current) {
+        const auto entries = list(directory);
+        for (const auto &e: entries->entries)
+          if ((e.is_directory || !want_directory) && (!e.name.starts_with('.') || segment.starts_with('.')) && match(e.name, segment))
+            next.push_back(join(directory, e.name));
+      }
+    }
+    current = std::move(next);
+  }
+
+  if (directories_only)
+    for (auto &p: current)
+      p += '/';
+  std::sort(current.begin(), current.end());
+  return current;
+}
+
+/**
+ * @brief Expands each pattern in turn and concatenates the results
+ */
+std::vector<std::string> directory_cache::glob(const std::vector<std::string> &patterns)
+{
+  std::vector<std::string> result;
+  for (const auto &pattern: patterns)
+    for (auto &p: glob(pattern))
+      result.push_back(std::move(p));
+  return result;
+}
+
+/**
+ * @brief Returns every directory listed since the cache was cleared with the timestamp it had when it was listed.
+ *        Directories that did not exist have the minimum timestamp.
+ */
+std::vector<std::pair<std::string, fs::file_time_type>> directory_cache::listed_directories()
+{
+  std::shared_lock<std::shared_mutex> guard(lock);
+  std::vector<std::pair<std::string, fs::file_time_type>> result(uncached_listings.begin(), uncached_listings.end());
+  for (const auto &[directory, cached]: listings)
+    result.push_back({ directory, cached->last_write_time });
+  return result;
+}
+
+void directory_cache::clear()
+{
+  std::unique_lock<std::shared_mutex> guard(lock);
+  listings.clear();
+  uncached_listings.clear();
+}
+} // namespace yakka
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <filesystem>
+#include <utility>
+
+namespace yakka {
+/**
+ * @brief Process-wide cache of directory listings used to expand glob patterns.
+ *        A listing is reused until the timestamp of its directory changes, which happens whenever an entry is added to,
+ *        removed from or renamed in the directory, so repeated and overlapping globs only read each directory once.
+ *        All accessors are thread-safe as globs are rendered from taskflow worker threads.
+ */
+class directory_cache {
+public:
+  struct entry {
+    std::string name;
+    bool is_directory;
+  };
+  struct listing {
+    std::filesystem::file_time_type last_write_time;
+    std::vector<entry> entries; // Sorted by name
+  };
+
+  std::shared_ptr<const listing> list(const std::string &directory);
+  std::vector<std::string> glob(const std::string &pattern);
+  std::vector<std::string> glob(const std::vector<std::string> &patterns);
+  std::vector<std::pair<std::string, std::filesystem::file_time_type>> listed_directories();
+  void clear();
+
+  static directory_cache &get();
+  static bool match(std::string_view name, std::string_view pattern);
+
+private:
+  std::shared_ptr<const listing> read_listing(const std::string &directory, std::filesystem::file_time_type last_write_time);
+  std::vector<std::string> walk(const std::vector<std::string> &directories, bool include_files);
+
+  std::shared_mutex lock;
+  std::unordered_map<std::string, std::shared_ptr<const listing>> listings;
+  std::unordered_map<std::string, std::filesystem::file_time_type> uncached_listings; // Missing or recently changed directories
+};
+} // namespace yakka
@@ -0,0 +1,157 @@
+#include "file_watcher.hpp"
+#include "spdlog/spdlog.h"
+#include <thread>
+#include <algorithm>
+
+#if defined(__linux__)
+  #include <poll.h>
+  #include <unistd.h>
+  #include <sys/inotify.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace yakka {
+// Time given to an editor or build step to finish writing related files before changes are reported
+static const auto settle_time = std::chrono::milliseconds(100);
+
+static const auto poll_interval = std::chrono::milliseconds(500);
+
+static std::string normalise(const std::string &path)
+{
+  return fs::path(path).lexically_normal().generic_string();
+}
+
+static fs::file_time_type timestamp(const std::string &path)
+{
+  std::error_code ec;
+  const auto time = fs::last_write_time(path, ec);
+  return ec ? fs::file_time_type::min() : time;
+}
+
+file_watcher::file_watcher() : inotify_fd(-1)
+{
+#if defined(__linux__)
+  inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0)
+    spdlog::warn("inotify is not available. Polling for file changes");
+#endif
+}
+
+file_watcher::~file_watcher()
+{
+#if defined(__linux__)
+  if (inotify_fd >= 0)
+    ::close(inotify_fd);
+#endif
+}
+
+bool file_watcher::is_polling() const
+{
+  return inotify_fd < 0;
+}
+
+/**
+ * @brief Replaces the set of watched files.
+ *        Files and directories that stay watched keep their state, so changes made since the last call, such as edits
+ *        saved during a build, are still reported by the next wait()
+ */
+void file_watcher::watch(const std::vector<std::string> &paths)
+{
+  watched_files.clear();
+  std::unordered_set<std::string> directories;
+  for (const auto &path: paths) {
+    const auto normalised = normalise(path);
+    watched_files.insert({ normalised, path });
+    const auto directory = fs::path(normalised).parent_path().generic_string();
+    directories.insert(directory.empty() ? "." : directory);
+  }
+
+  if (is_polling()) {
+    std::unordered_map<std::string, fs::file_time_type> previous_timestamps;
+    previous_timestamps.swap(timestamps);
+    for (const auto &[normalised, path]: watched_files) {
+      const auto previous = previous_timestamps.find(path);
+      timestamps[path]    = previous != previous_timestamps.end() ? previous->second : timestamp(path);
+    }
+    return;
+  }
+
+#if defined(__linux__)
+  // Events already queued for a directory carry its watch descriptor, so only directories that are no longer needed are removed
+  std::erase_if(watched_directories, [&](const auto &watched) {
+    if (directories.erase(watched.second) != 0)
+      return false;
+    ::inotify_rm_watch(inotify_fd, watched.first);
+    return true;
+  });
+  for (const auto &directory: directories) {
+    const int wd = ::inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB);
+    if (wd >= 0)
+      watched_directories[wd] = directory;
+    else
+      spdlog::info("Cannot watch '{}'", directory);
+  }
+#endif
+}
+
+/**
+ * @brief Waits for watched files to change
+ *
+ * @return The changed files as given to watch(). Empty if nothing changed before the timeout
+ */
+std::vector<std::string> file_watcher::wait(std::chrono::milliseconds timeout)
+{
+  if (is_polling()) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+      auto changes = poll_changes();
+      if (!changes.empty() || std::chrono::steady_clock::now() >= deadline)
+        return changes;
+      std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(poll_interval, deadline - std::chrono::steady_clock::now()));
+    }
+  }
+
+  std::unordered_set<std::string> changes;
+#if defined(__linux__)
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  pollfd poll_fd      = { inotify_fd, POLLIN, 0 };
+  while (true) {
+    // Once something changed keep collecting until the changes settle
+    const auto wait_time = changes.empty() ? std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()) : settle_time;
+    if (wait_time.count() < 0 || ::poll(&poll_fd, 1, static_cast<int>(wait_time.count())) <= 0)
+      break;
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    ssize_t length;
+    while ((length = ::read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+      for (char *position = buffer; position < buffer + length;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(position);
+        position += sizeof(inotify_event) + event->len;
+        const auto directory = watched_directories.find(event->wd);
+        if (directory == watched_directories.end() || event->len == 0)
+          continue;
+        const auto path = directory->second == "." ? std::string(event->name) : directory->second + "/" + event->name;
+        const auto file = watched_files.find(path);
+        if (file != watched_files.end())
+          changes.insert(file->second);
+      }
+    }
+  }
+#endif
+  return { changes.begin(), changes.end() };
+}
+
+std::vector<std::string> file_watcher::poll_changes()
+{
+  std::vector<std::string> changes;
+  for (auto &[path, last_write_time]: timestamps) {
+    const auto current = timestamp(path);
+    if (current != last_write_time) {
+      last_write_time = current;
+      changes.push_back(path);
+    }
+  }
+  return changes;
+}
+} // namespace yakka
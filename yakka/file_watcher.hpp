@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace yakka {
+/**
+ * @brief Reports changes to a set of files.
+ *        On Linux the parent directories of the files are watched with inotify so files replaced by editors through a rename
+ *        are still seen. Otherwise, or when inotify is not available, the timestamps of the files are polled.
+ */
+class file_watcher {
+public:
+  file_watcher();
+  file_watcher(const file_watcher &)            = delete;
+  file_watcher &operator=(const file_watcher &) = delete;
+  ~file_watcher();
+
+  void watch(const std::vector<std::string> &paths);
+  std::vector<std::string> wait(std::chrono::milliseconds timeout);
+  bool is_polling() const;
+
+private:
+  std::vector<std::string> poll_changes();
+
+  int inotify_fd;
+  std::unordered_map<int, std::string> watched_directories;
+  std::unordered_map<std::string, std::string> watched_files; // Normalised path to the path given to watch()
+  std::unordered_map<std::string, std::filesystem::file_time_type> timestamps;
+};
+} // namespace yakka
@@ -0,0 +1,299 @@
+#include "jobserver.hpp"
+#include "spdlog/spdlog.h"
+#include <format>
+#include <thread>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <filesystem>
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <unistd.h>
+  #include <sys/stat.h>
+#endif
+
+namespace yakka {
+// Time to wait for a token before checking whether the implicit token has been returned
+static const int token_poll_interval_ms = 100;
+
+static size_t default_job_count()
+{
+  return std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 32);
+}
+
+jobserver::token::token(jobserver *server, char value, bool implicit) : server(server), value(value), implicit(implicit)
+{
+}
+
+jobserver::token::~token()
+{
+  if (server)
+    server->release(value, implicit);
+}
+
+jobserver::jobserver()
+    : implicit_token_available(true), jobs(default_job_count()), client(false), read_fd(-1), write_fd(-1), owns_read_fd(false), blocking_read(false), inherited_read_fd(-1), inherited_write_fd(-1)
+{
+}
+
+jobserver::~jobserver()
+{
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  if (owns_read_fd)
+    ::close(read_fd);
+  if (inherited_read_fd >= 0) {
+    ::close(inherited_read_fd);
+    ::close(inherited_write_fd);
+  }
+  if (!fifo_path.empty())
+    ::unlink(fifo_path.c_str());
+#endif
+}
+
+/**
+ * @brief Connects to the jobserver of a parent make or creates a new jobserver.
+ *
+ * @param requested_jobs  Number of jobs requested on the command line or 0 to use the default
+ */
+void jobserver::init(size_t requested_jobs)
+{
+  jobs = requested_jobs != 0 ? requested_jobs : default_job_count();
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  // An explicit job count makes Yakka a new jobserver, as with a sub-make started with -j
+  const char *makeflags = std::getenv("MAKEFLAGS");
+  if (requested_jobs == 0 && makeflags != nullptr && init_client(makeflags))
+    return;
+
+  init_server();
+#endif
+}
+
+size_t jobserver::job_count() const
+{
+  return jobs;
+}
+
+bool jobserver::is_client() const
+{
+  return client;
+}
+
+/**
+ * @brief Parses the jobserver details from MAKEFLAGS. Supports both the 'fifo:PATH' and 'R,W' styles.
+ *
+ * @return true if the jobserver of the parent is usable
+ */
+bool jobserver::init_client(const std::string &makeflags)
+{
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  // The last instance of the option takes precedence
+  auto auth_position = makeflags.rfind("--jobserver-auth=");
+  size_t auth_offset = 17;
+  if (auth_position == std::string::npos) {
+    auth_position = makeflags.rfind("--jobserver-fds=");
+    auth_offset   = 16;
+  }
+  if (auth_position == std::string::npos)
+    return false;
+
+  const auto auth_start = auth_position + auth_offset;
+  const auto auth       = makeflags.substr(auth_start, makeflags.find(' ', auth_start) - auth_start);
+
+  if (auth.starts_with("fifo:")) {
+    read_fd = ::open(auth.substr(5).c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (read_fd < 0) {
+      spdlog::warn("Cannot open jobserver '{}'. Ignoring the parent jobserver", auth);
+      return false;
+    }
+    write_fd     = read_fd;
+    owns_read_fd = true;
+  } else {
+    int parent_read_fd  = -1;
+    int parent_write_fd = -1;
+    if (std::sscanf(auth.c_str(), "%d,%d", &parent_read_fd, &parent_write_fd) != 2 || ::fcntl(parent_read_fd, F_GETFD) < 0 || ::fcntl(parent_write_fd, F_GETFD) < 0) {
+      spdlog::warn("Jobserver '{}' is not available. Ignoring the parent jobserver", auth);
+      return false;
+    }
+
+    // Reopening the pipe gives a private file description that can be made non-blocking without affecting the parent.
+    // Without /proc, as on macOS, the descriptor of the parent is polled before every read instead
+    read_fd = ::open(std::format("/proc/self/fd/{}", parent_read_fd).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (read_fd >= 0)
+      owns_read_fd = true;
+    else {
+      read_fd       = parent_read_fd;
+      blocking_read = (::fcntl(read_fd, F_GETFL) & O_NONBLOCK) == 0;
+    }
+    write_fd = parent_write_fd;
+  }
+
+  // Use the job count of the parent as the number of workers
+  std::istringstream flags(makeflags);
+  std::string flag;
+  while (flags >> flag) {
+    if (!flag.starts_with("-j"))
+      continue;
+    const auto parent_jobs = std::strtoul(flag.c_str() + 2, nullptr, 10);
+    if (parent_jobs != 0)
+      jobs = parent_jobs;
+  }
+
+  client = true;
+  spdlog::info("Using jobserver '{}' with {} jobs", auth, jobs);
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Creates a named FIFO holding one token for each job beyond the implicit one and exports it through MAKEFLAGS.
+ *        Yakka uses a non-blocking descriptor of its own while the tools inherit blocking ones. The FIFO is given by
+ *        path for GNU make 4.4, GCC 13 and ninja, followed by the inherited descriptors in the style of older versions of
+ *        make, which take the last of the two options. A pipe is used instead when the FIFO cannot be created.
+ */
+void jobserver::init_server()
+{
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  static std::atomic<unsigned> fifo_count = 0;
+  std::error_code ec;
+  const auto directory = std::filesystem::temp_directory_path(ec);
+  if (!ec) {
+    const auto path = (directory / std::format("yakka-jobserver-{}-{}", ::getpid(), fifo_count++)).string();
+    if (::mkfifo(path.c_str(), 0600) == 0) {
+      fifo_path = path;
+      read_fd   = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+      // The descriptor of Yakka is a writer so opening the read end doesn't wait
+      inherited_read_fd  = read_fd >= 0 ? ::open(path.c_str(), O_RDONLY) : -1;
+      inherited_write_fd = inherited_read_fd >= 0 ? ::open(path.c_str(), O_WRONLY) : -1;
+      if (inherited_write_fd < 0) {
+        spdlog::warn("Failed to open jobserver '{}': {}", path, std::strerror(errno));
+        for (auto fd: { read_fd, inherited_read_fd })
+          if (fd >= 0)
+            ::close(fd);
+        read_fd = inherited_read_fd = -1;
+        ::unlink(path.c_str());
+        fifo_path.clear();
+      } else {
+        write_fd     = read_fd;
+        owns_read_fd = true;
+      }
+    }
+  }
+
+  if (fifo_path.empty()) {
+    int pipe_fds[2];
+    if (::pipe(pipe_fds) != 0) {
+      spdlog::warn("Failed to create jobserver: {}", std::strerror(errno));
+      return;
+    }
+    inherited_read_fd  = pipe_fds[0];
+    inherited_write_fd = pipe_fds[1];
+    write_fd           = inherited_write_fd;
+
+    // Reopening the pipe gives a private file description that can be made non-blocking while the tools keep a blocking one
+    read_fd = ::open(std::format("/proc/self/fd/{}", inherited_read_fd).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (read_fd >= 0)
+      owns_read_fd = true;
+    else {
+      read_fd       = inherited_read_fd;
+      blocking_read = true;
+    }
+  }
+
+  const std::string tokens(jobs - 1, '+');
+  if (!tokens.empty() && ::write(write_fd, tokens.data(), tokens.size()) != static_cast<ssize_t>(tokens.size()))
+    spdlog::warn("Failed to fill jobserver");
+
+  const char *makeflags = std::getenv("MAKEFLAGS");
+  const auto fds        = std::format("{},{}", inherited_read_fd, inherited_write_fd);
+  const auto auth       = fifo_path.empty() ? fds : "fifo:" + fifo_path;
+  const auto jobflags   = std::format("-j{} --jobserver-auth={} --jobserver-fds={}", jobs, auth, fds);
+  ::setenv("MAKEFLAGS", (makeflags != nullptr && *makeflags != '\0') ? std::format("{} {}", makeflags, jobflags).c_str() : jobflags.c_str(), 1);
+  spdlog::info("Created jobserver '{}' with {} jobs", auth, jobs);
+#endif
+}
+
+/**
+ * @brief Reads a token if one is available without waiting for one.
+ *        A blocking descriptor is only read once poll() reports a token, so a token taken by another process in between
+ *        is the only way a read can block, until that process returns a token.
+ *
+ * @return 1 if a token was read, 0 if there was none, or -1 if the jobserver failed
+ */
+int jobserver::read_token(char &value)
+{
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  std::unique_lock<std::mutex> guard(read_lock, std::defer_lock);
+  if (blocking_read) {
+    guard.lock();
+    pollfd poll_fd = { read_fd, POLLIN, 0 };
+    if (::poll(&poll_fd, 1, 0) <= 0 || (poll_fd.revents & POLLIN) == 0)
+      return 0;
+  }
+  const auto result = ::read(read_fd, &value, 1);
+  if (result == 1)
+    return 1;
+  if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    spdlog::error("Failed to read from jobserver: {}", std::strerror(errno));
+    return -1;
+  }
+#endif
+  return 0;
+}
+
+/**
+ * @brief Waits for a job token. The token is returned to the jobserver when it is destroyed.
+ */
+jobserver::token jobserver::acquire()
+{
+  if (read_fd < 0)
+    return token(nullptr, 0, false);
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  while (true) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (implicit_token_available) {
+        implicit_token_available = false;
+        return token(this, 0, true);
+      }
+    }
+
+    char value;
+    const auto result = read_token(value);
+    if (result > 0)
+      return token(this, value, false);
+    if (result < 0)
+      return token(nullptr, 0, false);
+
+    // No token is available. Wait for one to be returned or for the implicit token to become free
+    pollfd poll_fd = { read_fd, POLLIN, 0 };
+    ::poll(&poll_fd, 1, token_poll_interval_ms);
+  }
+#else
+  return token(nullptr, 0, false);
+#endif
+}
+
+void jobserver::release(char value, bool implicit)
+{
+  if (implicit) {
+    std::lock_guard<std::mutex> guard(lock);
+    implicit_token_available = true;
+    return;
+  }
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  while (::write(write_fd, &value, 1) < 0 && errno == EINTR) {
+  }
+#endif
+}
+} // namespace yakka
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <cstddef>
+
+namespace yakka {
+/**
+ * @brief GNU make compatible jobserver.
+ *        When Yakka is started by make with a jobserver it acts as a client and shares the tokens of the parent.
+ *        Otherwise it creates a jobserver of its own and exports it through MAKEFLAGS so tools such as make, ninja, and
+ *        gcc -flto=auto started by a blueprint share the same job limit instead of each starting their own parallelism.
+ *        The jobserver is a named FIFO. It is exported both by path, for GNU make 4.4, GCC 13 and ninja onwards, and as a
+ *        pair of inherited descriptors for older tools.
+ *        Every process step holds a token while it runs. The first token is implicit and is never read from the jobserver.
+ *        Tokens are read without blocking so a waiting worker still notices when the implicit token is returned.
+ */
+class jobserver {
+public:
+  class token {
+  public:
+    token(jobserver *server, char value, bool implicit);
+    token(const token &)            = delete;
+    token &operator=(const token &) = delete;
+    ~token();
+
+  private:
+    jobserver *server;
+    char value;
+    bool implicit;
+  };
+
+  jobserver();
+  ~jobserver();
+
+  void init(size_t requested_jobs);
+  size_t job_count() const;
+  bool is_client() const;
+  token acquire();
+
+private:
+  void release(char value, bool implicit);
+  bool init_client(const std::string &makeflags);
+  void init_server();
+  int read_token(char &value);
+
+  std::mutex lock;
+  std::mutex read_lock;
+  bool implicit_token_available;
+  size_t jobs;
+  bool client;
+  int read_fd;
+  int write_fd;
+  bool owns_read_fd;
+  bool blocking_read; // The read descriptor is shared with other processes and cannot be made non-blocking
+  int inherited_read_fd;  // Descriptors of the jobserver created by this process that the tools inherit, or -1
+  int inherited_write_fd;
+  std::string fifo_path; // Named FIFO created by this process, removed when the jobserver is destroyed
+};
+} // namespace yakka
@@ -0,0 +1,159 @@
+#include "memory_admission.hpp"
+#include "spdlog/spdlog.h"
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#if defined(__linux__)
+  #include <unistd.h>
+#endif
+
+namespace yakka {
+// Available memory changes without notice so waiting commands check it again at this interval
+static const auto memory_poll_interval = std::chrono::milliseconds(100);
+
+// Set while a ticket is held on the current thread so the processes it spawns are counted against its reservation
+static thread_local memory_admission *current_admission = nullptr;
+static thread_local uint64_t current_reservation        = 0;
+
+memory_admission::ticket::ticket(memory_admission *admission, uint64_t reservation)
+    : admission(admission), reservation(reservation), previous_admission(current_admission), previous_reservation(current_reservation)
+{
+  current_admission   = admission;
+  current_reservation = reservation;
+}
+
+memory_admission::ticket::~ticket()
+{
+  current_admission   = previous_admission;
+  current_reservation = previous_reservation;
+  if (admission)
+    admission->release(reservation);
+}
+
+memory_admission::memory_admission() : enabled(false), next_reservation(0)
+{
+}
+
+void memory_admission::enable()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  enabled = available_memory().has_value();
+  if (!enabled)
+    spdlog::warn("Available memory is not known on this system. Ignoring --adaptive");
+}
+
+bool memory_admission::is_enabled() const
+{
+  return enabled;
+}
+
+/**
+ * @brief Waits until a command expected to use @p expected_memory kB can run. The memory is reserved until the ticket is destroyed.
+ */
+memory_admission::ticket memory_admission::admit(uint64_t expected_memory)
+{
+  if (!enabled)
+    return ticket(nullptr, 0);
+
+  std::unique_lock<std::mutex> guard(lock);
+  bool waited = false;
+  while (true) {
+    const auto available = available_memory();
+    if (reservations.empty() || !available.has_value())
+      break;
+    const auto unrealised = unrealised_memory();
+    if (unrealised + expected_memory <= available.value())
+      break;
+    if (!waited)
+      spdlog::info("Waiting for {} MB of memory. {} MB available with {} MB reserved", expected_memory / 1024, available.value() / 1024, unrealised / 1024);
+    waited = true;
+    released.wait_for(guard, memory_poll_interval);
+  }
+
+  const auto id = next_reservation++;
+  reservations.insert({ id, { expected_memory, {} } });
+  return ticket(this, id);
+}
+
+void memory_admission::release(uint64_t reservation)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    reservations.erase(reservation);
+  }
+  released.notify_all();
+}
+
+/**
+ * @brief Returns the memory reserved by the running commands that their processes are not using yet, in kB
+ */
+uint64_t memory_admission::unrealised_memory() const
+{
+  uint64_t unrealised = 0;
+  for (const auto &[id, reserved]: reservations) {
+    uint64_t resident = 0;
+    for (const auto pid: reserved.processes)
+      resident += resident_memory(pid).value_or(0);
+    unrealised += reserved.expected_memory - std::min(resident, reserved.expected_memory);
+  }
+  return unrealised;
+}
+
+/**
+ * @brief Counts a process spawned on the current thread against the reservation of the ticket held by the thread, if any
+ */
+void memory_admission::add_process(int pid)
+{
+  if (current_admission == nullptr)
+    return;
+  std::lock_guard<std::mutex> guard(current_admission->lock);
+  const auto reserved = current_admission->reservations.find(current_reservation);
+  if (reserved != current_admission->reservations.end())
+    reserved->second.processes.push_back(pid);
+}
+
+/**
+ * @brief Stops counting a process that has been reaped. Must be called on the thread that added it
+ */
+void memory_admission::remove_process(int pid)
+{
+  if (current_admission == nullptr)
+    return;
+  std::lock_guard<std::mutex> guard(current_admission->lock);
+  const auto reserved = current_admission->reservations.find(current_reservation);
+  if (reserved != current_admission->reservations.end())
+    std::erase(reserved->second.processes, pid);
+}
+
+/**
+ * @brief Returns the memory available for new processes in kB, as reported by MemAvailable in /proc/meminfo
+ */
+std::optional<uint64_t> memory_admission::available_memory()
+{
+#if defined(__linux__)
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line))
+    if (line.starts_with("MemAvailable:"))
+      return std::stoull(line.substr(13));
+#endif
+  return std::nullopt;
+}
+
+/**
+ * @brief Returns the resident set size of a process in kB, as reported by /proc/PID/statm
+ */
+std::optional<uint64_t> memory_admission::resident_memory(int pid)
+{
+#if defined(__linux__)
+  std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+  uint64_t size     = 0;
+  uint64_t resident = 0;
+  if (statm >> size >> resident)
+    return resident * (::sysconf(_SC_PAGESIZE) / 1024);
+#endif
+  return std::nullopt;
+}
+} // namespace yakka
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace yakka {
+/**
+ * @brief Limits the commands running at once by the memory they are expected to use.
+ *        A command is admitted when its expected peak memory, plus the part of the expected peak memory of the commands
+ *        already running that their processes are not using yet, fits in the memory the system reports as available.
+ *        The memory a process already uses is part of what the system no longer reports as available, so only the
+ *        unrealised part of each reservation is counted. The expectation comes from previous runs.
+ *        The processes spawned on the thread holding a ticket are counted against its reservation.
+ *        One command is always admitted so the build makes progress. Admission is unlimited until the limit is enabled.
+ */
+class memory_admission {
+public:
+  class ticket {
+  public:
+    ticket(memory_admission *admission, uint64_t reservation);
+    ticket(const ticket &)            = delete;
+    ticket &operator=(const ticket &) = delete;
+    ~ticket();
+
+  private:
+    memory_admission *admission;
+    uint64_t reservation;
+    memory_admission *previous_admission;
+    uint64_t previous_reservation;
+  };
+
+  memory_admission();
+  void enable();
+  bool is_enabled() const;
+  ticket admit(uint64_t expected_memory);
+
+  static std::optional<uint64_t> available_memory();
+  static std::optional<uint64_t> resident_memory(int pid);
+  static void add_process(int pid);
+  static void remove_process(int pid);
+
+private:
+  struct reservation {
+    uint64_t expected_memory;
+    std::vector<int> processes;
+  };
+
+  void release(uint64_t reservation);
+  uint64_t unrealised_memory() const;
+
+  std::mutex lock;
+  std::condition_variable released;
+  bool enabled;
+  uint64_t next_reservation;
+  std::map<uint64_t, reservation> reservations;
+};
+} // namespace yakka
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <semaphore>
+#include <utility>
+
+namespace yakka {
+/**
+ * @brief Unbounded queue that any number of threads push to without locking and a single thread pops from.
+ *        Pushing never blocks. The consumer can sleep until something is pushed or @ref notify is called.
+ *        Based on the intrusive MPSC queue by Dmitry Vyukov.
+ */
+template<typename T> class mpsc_queue {
+public:
+  mpsc_queue() : head(&stub), tail(&stub), signal(0)
+  {
+  }
+  mpsc_queue(const mpsc_queue &)            = delete;
+  mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+  ~mpsc_queue()
+  {
+    while (pop().has_value())
+      ;
+  }
+
+  void push(T value)
+  {
+    link(new node(std::move(value)));
+    notify();
+  }
+
+  /**
+   * @brief Takes the oldest value from the queue. Only called by the consumer.
+   *
+   * @return The value or nothing when the queue is empty or a push has not completed yet
+   */
+  std::optional<T> pop()
+  {
+    node *current = tail;
+    node *next    = current->next.load(std::memory_order_acquire);
+    if (current == &stub) {
+      if (next == nullptr)
+        return std::nullopt;
+      tail    = next;
+      current = next;
+      next    = next->next.load(std::memory_order_acquire);
+    }
+    if (next == nullptr) {
+      // The last node can only be taken once the stub is behind it
+      if (current != head.load(std::memory_order_acquire))
+        return std::nullopt;
+      link(&stub);
+      next = current->next.load(std::memory_order_acquire);
+      if (next == nullptr)
+        return std::nullopt;
+    }
+    tail = next;
+    std::optional<T> value(std::move(current->value));
+    delete current;
+    return value;
+  }
+
+  /**
+   * @brief Wakes the consumer without pushing anything
+   */
+  void notify()
+  {
+    signal.release();
+  }
+
+  /**
+   * @brief Sleeps until something is pushed, @ref notify is called, or the timeout expires. Only called by the consumer.
+   */
+  template<typename Rep, typename Period> void wait_for(const std::chrono::duration<Rep, Period> &timeout)
+  {
+    if (signal.try_acquire_for(timeout))
+      while (signal.try_acquire())
+        ;
+  }
+
+private:
+  struct node {
+    std::atomic<node *> next;
+    T value;
+
+    node() : next(nullptr)
+    {
+    }
+    explicit node(T value) : next(nullptr), value(std::move(value))
+    {
+    }
+  };
+
+  void link(node *item)
+  {
+    item->next.store(nullptr, std::memory_order_relaxed);
+    node *previous = head.exchange(item, std::memory_order_acq_rel);
+    previous->next.store(item, std::memory_order_release);
+  }
+
+  node stub;
+  std::atomic<node *> head;
+  node *tail;
+  std::counting_semaphore<> signal;
+};
+} // namespace yakka
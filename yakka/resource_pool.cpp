@@ -0,0 +1,67 @@
+#include "resource_pool.hpp"
+#include <algorithm>
+
+namespace yakka {
+resource_pool::resource_pool(size_t capacity) : pool_capacity(capacity), units(capacity), reservation(1)
+{
+}
+
+size_t resource_pool::capacity() const
+{
+  return pool_capacity;
+}
+
+/**
+ * @brief Makes a task hold units of resource pools while it runs. Requests for more units than a pool has are clamped
+ *        to the pool's capacity. The requests must be given in the same pool order for every task so that tasks
+ *        gathering units of several pools can't wait on each other.
+ * @return The task that the dependencies of the task must precede, which is the task itself when no units are gathered
+ */
+tf::Task resource_pool::acquire(tf::Taskflow &taskflow, tf::Task task, const std::vector<request> &requests)
+{
+  const bool gathering = std::any_of(requests.begin(), requests.end(), [](const request &r) {
+    return std::min(r.second, r.first->pool_capacity) > 1;
+  });
+
+  // Single units of different pools are acquired together by the task itself
+  if (!gathering) {
+    for (const auto &[pool, units]: requests)
+      if (units != 0) {
+        task.acquire(pool->units);
+        task.release(pool->units);
+      }
+    return task;
+  }
+
+  tf::Task first;
+  tf::Task last;
+  const auto append = [&](tf::Task step) {
+    if (last.empty())
+      first = step;
+    else
+      last.precede(step);
+    last = step;
+  };
+
+  for (const auto &[pool, requested]: requests) {
+    const auto units = std::min(requested, pool->pool_capacity);
+    if (units == 0)
+      continue;
+    if (units > 1) {
+      auto reserve = taskflow.placeholder();
+      reserve.acquire(pool->reservation);
+      append(reserve);
+    }
+    for (size_t unit = 0; unit < units; ++unit) {
+      auto step = taskflow.placeholder();
+      step.acquire(pool->units);
+      append(step);
+      task.release(pool->units);
+    }
+    if (units > 1)
+      last.release(pool->reservation);
+  }
+  last.precede(task);
+  return first;
+}
+} // namespace yakka
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "taskflow.hpp"
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace yakka {
+/**
+ * @brief A number of units, such as link slots or gigabytes of memory, shared by the tasks of a build.
+ *        Waiting tasks are parked by Taskflow rather than holding a worker. Taskflow semaphores only count one unit
+ *        per acquisition, so a task needing several units gathers them one at a time in placeholder tasks that run
+ *        before it. Only one task of a pool gathers at a time, so two gathering tasks can't each hold part of the pool.
+ */
+class resource_pool {
+public:
+  using request = std::pair<resource_pool *, size_t>;
+
+  explicit resource_pool(size_t capacity);
+  resource_pool(const resource_pool &)            = delete;
+  resource_pool &operator=(const resource_pool &) = delete;
+
+  size_t capacity() const;
+
+  static tf::Task acquire(tf::Taskflow &taskflow, tf::Task task, const std::vector<request> &requests);
+
+private:
+  size_t pool_capacity;
+  tf::Semaphore units;
+  tf::Semaphore reservation; // Held by the task gathering several units of the pool
+};
+} // namespace yakka
@@ -0,0 +1,114 @@
+#include "stat_cache.hpp"
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace yakka {
+// Number of threads used to query the metadata of a batch of files. Network filesystems benefit from many requests in flight
+static const size_t max_prefetch_threads = 32;
+static const size_t paths_per_thread     = 64;
+
+/**
+ * @brief Queries the metadata of a file from the filesystem, following symbolic links.
+ *        On Linux a single statx() call retrieves only the fields that are needed.
+ */
+stat_cache::file_status stat_cache::read_status(const std::string &path)
+{
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+  struct statx buffer;
+  if (::statx(AT_FDCWD, path.c_str(), AT_STATX_SYNC_AS_STAT, STATX_TYPE | STATX_MTIME | STATX_SIZE, &buffer) != 0)
+    return { false, false, 0, std::filesystem::file_time_type::min() };
+
+  const auto modified = std::chrono::sys_time<std::chrono::nanoseconds>(std::chrono::seconds(buffer.stx_mtime.tv_sec) + std::chrono::nanoseconds(buffer.stx_mtime.tv_nsec));
+  return { true, S_ISREG(buffer.stx_mode), buffer.stx_size, std::chrono::file_clock::from_sys(modified) };
+#else
+  std::error_code ec;
+  const auto status = std::filesystem::status(path, ec);
+  if (ec || !std::filesystem::exists(status))
+    return { false, false, 0, std::filesystem::file_time_type::min() };
+
+  const bool is_regular_file = std::filesystem::is_regular_file(status);
+  const auto size            = is_regular_file ? std::filesystem::file_size(path, ec) : 0;
+  const auto last_write_time = std::filesystem::last_write_time(path, ec);
+  return { true, is_regular_file, ec ? 0 : size, ec ? std::filesystem::file_time_type::min() : last_write_time };
+#endif
+}
+
+stat_cache::file_status stat_cache::status(const std::string &path)
+{
+  {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    const auto entry = entries.find(path);
+    if (entry != entries.end())
+      return entry->second;
+  }
+
+  const auto result = read_status(path);
+  std::unique_lock<std::shared_mutex> guard(lock);
+  entries.insert_or_assign(path, result);
+  return result;
+}
+
+bool stat_cache::exists(const std::string &path)
+{
+  return status(path).exists;
+}
+
+/**
+ * @brief Returns the timestamp of a file or file_time_type::min() if it does not exist
+ */
+std::filesystem::file_time_type stat_cache::last_write_time(const std::string &path)
+{
+  return status(path).last_write_time;
+}
+
+void stat_cache::invalidate(const std::string &path)
+{
+  std::unique_lock<std::shared_mutex> guard(lock);
+  entries.erase(path);
+}
+
+/**
+ * @brief Queries the metadata of many files in parallel so the latency of each request overlaps with the others.
+ *        Paths that are already cached are skipped.
+ */
+void stat_cache::prefetch(const std::vector<std::string> &paths)
+{
+  std::vector<const std::string *> missing;
+  {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    for (const auto &path: paths)
+      if (!entries.contains(path))
+        missing.push_back(&path);
+  }
+  if (missing.empty())
+    return;
+
+  std::vector<file_status> results(missing.size());
+  const size_t thread_count = std::clamp<size_t>(missing.size() / paths_per_thread, 1, std::min<size_t>(max_prefetch_threads, std::max(1U, std::thread::hardware_concurrency()) * 4));
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_count; ++t)
+    threads.emplace_back([&, t]() {
+      for (size_t i = t; i < missing.size(); i += thread_count)
+        results[i] = read_status(*missing[i]);
+    });
+  for (auto &thread: threads)
+    thread.join();
+
+  std::unique_lock<std::shared_mutex> guard(lock);
+  for (size_t i = 0; i < missing.size(); ++i)
+    entries.try_emplace(*missing[i], results[i]);
+}
+
+void stat_cache::clear()
+{
+  std::unique_lock<std::shared_mutex> guard(lock);
+  entries.clear();
+}
+} // namespace yakka
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <shared_mutex>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
+
+namespace yakka {
+/**
+ * @brief Build-scoped cache of file metadata so each path is only queried from the filesystem once per build.
+ *        Entries stay valid until they are invalidated, which must happen whenever a task writes to the path.
+ *        All accessors are thread-safe as they are called from taskflow worker threads.
+ */
+class stat_cache {
+public:
+  struct file_status {
+    bool exists;
+    bool is_regular_file;
+    uintmax_t size;
+    std::filesystem::file_time_type last_write_time;
+  };
+
+  file_status status(const std::string &path);
+  bool exists(const std::string &path);
+  std::filesystem::file_time_type last_write_time(const std::string &path);
+  void invalidate(const std::string &path);
+  void prefetch(const std::vector<std::string> &paths);
+  void clear();
+
+  static file_status read_status(const std::string &path);
+
+private:
+  std::shared_mutex lock;
+  std::unordered_map<std::string, file_status> entries;
+};
+} // namespace yakka
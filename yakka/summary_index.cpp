@@ -0,0 +1,163 @@
+#include "summary_index.hpp"
+#include "utilities.hpp"
+#include "spdlog/spdlog.h"
+#include <fstream>
+#include <algorithm>
+
+namespace yakka {
+/**
+ * @brief Replaces the index with the digests of the components in @p summary
+ */
+void summary_index::build(const nlohmann::json &summary)
+{
+  components.clear();
+  if (summary.contains("components") && summary["components"].is_object())
+    for (const auto &[name, value]: summary["components"].items())
+      add_entries(components[name], "", value);
+  index_names();
+}
+
+/**
+ * @brief Indexes @p value and, if it is an object, its members
+ *
+ * @return Digest of @p value
+ */
+uint64_t summary_index::add_entries(component_entries &entries, const std::string &pointer, const nlohmann::json &value)
+{
+  uint64_t digest;
+  if (value.is_object()) {
+    digest = hash_bytes("{");
+    for (const auto &[key, member]: value.items()) {
+      // Escape the key as a JSON pointer reference token
+      std::string token = key;
+      for (size_t i = 0; (i = token.find_first_of("~/", i)) != std::string::npos; i += 2)
+        token.replace(i, 1, token[i] == '~' ? "~0" : "~1");
+      digest = hash_combine(digest, hash_bytes(key));
+      digest = hash_combine(digest, add_entries(entries, pointer + "/" + token, member));
+    }
+  } else {
+    digest = hash_bytes(value.dump());
+  }
+  entries[pointer] = { digest, value.is_object() };
+  return digest;
+}
+
+void summary_index::load(const std::string &path)
+{
+  components.clear();
+  std::ifstream index_file(path);
+  if (!index_file.is_open()) {
+    index_names();
+    return;
+  }
+
+  try {
+    const auto index = nlohmann::json::parse(index_file);
+    for (const auto &[name, pointers]: index.items()) {
+      auto &entries = components[name];
+      for (const auto &[pointer, record]: pointers.items())
+        entries[pointer] = { record[0].get<uint64_t>(), record[1].get<bool>() };
+    }
+  } catch (std::exception &e) {
+    spdlog::info("Ignoring summary index '{}': {}", path, e.what());
+    components.clear();
+  }
+  index_names();
+}
+
+void summary_index::save(const std::string &path) const
+{
+  nlohmann::json index = nlohmann::json::object();
+  for (const auto &[name, entries]: components) {
+    auto &pointers = index[name];
+    pointers       = nlohmann::json::object();
+    for (const auto &[pointer, record]: entries)
+      pointers[pointer] = { record.digest, record.is_object };
+  }
+  std::ofstream index_file(path);
+  index_file << index.dump();
+}
+
+bool summary_index::empty() const
+{
+  return components.empty();
+}
+
+bool summary_index::contains(const std::string &component) const
+{
+  return components.contains(component);
+}
+
+/**
+ * @brief Finds the digest of the data at @p pointer in a component
+ *
+ * @return The digest or nothing if the component or the data doesn't exist
+ */
+std::optional<uint64_t> summary_index::find(const std::string &component, const std::string &pointer) const
+{
+  const auto entries = components.find(component);
+  if (entries == components.end())
+    return std::nullopt;
+
+  // Use the closest indexed parent when the pointer is not indexed itself
+  std::string prefix = pointer;
+  while (true) {
+    const auto record = entries->second.find(prefix);
+    if (record != entries->second.end()) {
+      if (prefix.size() == pointer.size())
+        return record->second.digest;
+      // Every member of an object is indexed, so the data doesn't exist
+      if (record->second.is_object)
+        return std::nullopt;
+      return hash_combine(record->second.digest, hash_bytes(std::string_view(pointer).substr(prefix.size())));
+    }
+    const auto separator = prefix.rfind('/');
+    if (separator == std::string::npos)
+      return std::nullopt;
+    prefix.resize(separator);
+  }
+}
+
+/**
+ * @brief Sorts the component names and forgets the wildcard digests of the previous contents
+ */
+void summary_index::index_names()
+{
+  names.clear();
+  names.reserve(components.size());
+  for (const auto &[name, entries]: components)
+    names.push_back(name);
+  std::sort(names.begin(), names.end());
+  wildcard_digests = std::make_shared<wildcard_cache>();
+}
+
+const std::vector<std::string> &summary_index::component_names() const
+{
+  return names;
+}
+
+/**
+ * @brief Returns a digest of the data at @p pointer in every component, in name order. Components without the data
+ *        contribute their name only. The digest is computed on the first call for each pointer.
+ */
+uint64_t summary_index::wildcard_digest(const std::string &pointer) const
+{
+  {
+    std::shared_lock<std::shared_mutex> guard(wildcard_digests->lock);
+    const auto cached = wildcard_digests->digests.find(pointer);
+    if (cached != wildcard_digests->digests.end())
+      return cached->second;
+  }
+
+  uint64_t digest = hash_bytes(pointer);
+  for (const auto &name: names) {
+    digest            = hash_combine(digest, hash_bytes(name));
+    const auto result = find(name, pointer);
+    if (result.has_value())
+      digest = hash_combine(digest, result.value());
+  }
+  std::unique_lock<std::shared_mutex> guard(wildcard_digests->lock);
+  wildcard_digests->digests.insert({ pointer, digest });
+  return digest;
+}
+} // namespace yakka
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include <string>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <memory>
+#include <shared_mutex>
+#include <cstdint>
+
+namespace yakka {
+/**
+ * @brief Digests of the component data in a project summary, indexed by component and JSON pointer.
+ *        Every object member is indexed so data dependencies can be checked by comparing digests instead of JSON trees.
+ *        Arrays and values are indexed as a whole, so a pointer into an array uses the digest of the array.
+ *        The digest of a pointer across all components is computed once and kept until the index is built or loaded again.
+ */
+class summary_index {
+public:
+  void build(const nlohmann::json &summary);
+  void load(const std::string &path);
+  void save(const std::string &path) const;
+  bool empty() const;
+  bool contains(const std::string &component) const;
+  std::optional<uint64_t> find(const std::string &component, const std::string &pointer) const;
+  const std::vector<std::string> &component_names() const;
+  uint64_t wildcard_digest(const std::string &pointer) const;
+
+private:
+  struct entry {
+    uint64_t digest;
+    bool is_object;
+  };
+  using component_entries = std::unordered_map<std::string, entry>;
+
+  // Shared by copies of the index as they have the same digests
+  struct wildcard_cache {
+    std::shared_mutex lock;
+    std::unordered_map<std::string, uint64_t> digests;
+  };
+
+  static uint64_t add_entries(component_entries &entries, const std::string &pointer, const nlohmann::json &value);
+  void index_names();
+
+  std::unordered_map<std::string, component_entries> components;
+  std::vector<std::string> names; // Sorted
+  std::shared_ptr<wildcard_cache> wildcard_digests = std::make_shared<wildcard_cache>();
+};
+} // namespace yakka
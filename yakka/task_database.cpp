@@ -0,0 +1,281 @@
+#include "task_database.hpp"
+#include "utilities.hpp"
+#include "spdlog/spdlog.h"
+#include "json.hpp"
+#include <fstream>
+
+namespace yakka {
+task_database::task_database() : is_dirty(false)
+{
+}
+
+void task_database::load(const std::string path)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  files.clear();
+  input_digests.clear();
+  command_signatures.clear();
+  command_inputs.clear();
+  durations.clear();
+  input_times.clear();
+  usages.clear();
+  is_dirty = false;
+
+  if (!std::filesystem::exists(path))
+    return;
+
+  try {
+    std::ifstream database_file(path);
+    const auto database = nlohmann::json::parse(database_file);
+
+    for (const auto &[name, record]: database["files"].items())
+      files.insert({ name, { record[0].get<int64_t>(), record[1].get<uintmax_t>(), record[2].get<uint64_t>() } });
+
+    for (const auto &[name, digest]: database["targets"].items())
+      input_digests.insert({ name, digest.get<uint64_t>() });
+
+    if (database.contains("commands"))
+      for (const auto &[name, signature]: database["commands"].items())
+        command_signatures.insert({ name, signature.get<uint64_t>() });
+
+    if (database.contains("command_inputs"))
+      for (const auto &[name, digest]: database["command_inputs"].items())
+        command_inputs.insert({ name, digest.get<uint64_t>() });
+
+    if (database.contains("durations"))
+      for (const auto &[name, duration]: database["durations"].items())
+        durations.insert({ name, duration.get<uint64_t>() });
+
+    if (database.contains("input_times"))
+      for (const auto &[name, input_time]: database["input_times"].items())
+        input_times.insert({ name, input_time.get<int64_t>() });
+
+    if (database.contains("usage"))
+      for (const auto &[name, usage]: database["usage"].items())
+        usages.insert({ name, { usage[0].get<uint64_t>(), usage[1].get<uint64_t>(), usage[2].get<uint64_t>(), usage[3].get<uint64_t>() } });
+  } catch (std::exception &e) {
+    spdlog::info("Ignoring invalid task database '{}': {}", path, e.what());
+    files.clear();
+    input_digests.clear();
+    command_signatures.clear();
+    command_inputs.clear();
+    durations.clear();
+    input_times.clear();
+    usages.clear();
+  }
+}
+
+void task_database::save(const std::string path)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  if (!is_dirty)
+    return;
+
+  nlohmann::json database;
+  database["files"]       = nlohmann::json::object();
+  database["targets"]     = nlohmann::json::object();
+  database["commands"]       = nlohmann::json::object();
+  database["command_inputs"] = nlohmann::json::object();
+  database["durations"]      = nlohmann::json::object();
+  database["input_times"]    = nlohmann::json::object();
+  database["usage"]          = nlohmann::json::object();
+  for (const auto &[name, record]: files)
+    database["files"][name] = { record.last_write_time, record.size, record.digest };
+  for (const auto &[name, digest]: input_digests)
+    database["targets"][name] = digest;
+  for (const auto &[name, signature]: command_signatures)
+    database["commands"][name] = signature;
+  for (const auto &[name, digest]: command_inputs)
+    database["command_inputs"][name] = digest;
+  for (const auto &[name, duration]: durations)
+    database["durations"][name] = duration;
+  for (const auto &[name, input_time]: input_times)
+    database["input_times"][name] = input_time;
+  for (const auto &[name, usage]: usages)
+    database["usage"][name] = { usage.peak_memory, usage.cpu_time, usage.read_bytes, usage.write_bytes };
+
+  // Write to a temporary file and rename so an interrupted save never leaves a truncated database
+  const auto temp_path = path + ".tmp";
+  {
+    std::ofstream database_file(temp_path, std::ios_base::binary);
+    if (!database_file.is_open()) {
+      spdlog::error("Failed to save task database: '{}'", path);
+      return;
+    }
+    database_file << database.dump();
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    spdlog::error("Failed to save task database: '{}': {}", path, ec.message());
+    return;
+  }
+  is_dirty = false;
+}
+
+/**
+ * @brief Returns the content digest of a file.
+ *        The file is only read and hashed when its timestamp or size differs from the stored record.
+ *
+ * @param file_path  Path of the file
+ * @return std::optional<uint64_t>  Digest of the file content or std::nullopt if the file cannot be read
+ */
+std::optional<uint64_t> task_database::file_digest(const std::filesystem::path &file_path)
+{
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(file_path, ec);
+  if (ec)
+    return std::nullopt;
+  const auto last_write_time = std::filesystem::last_write_time(file_path, ec).time_since_epoch().count();
+  if (ec)
+    return std::nullopt;
+
+  return file_digest(file_path, size, last_write_time);
+}
+
+/**
+ * @brief Returns the content digest of a file whose size and timestamp are already known
+ */
+std::optional<uint64_t> task_database::file_digest(const std::filesystem::path &file_path, uintmax_t size, int64_t last_write_time)
+{
+  const auto key = file_path.generic_string();
+  {
+    std::lock_guard<std::mutex> lock(database_lock);
+    auto record = files.find(key);
+    if (record != files.end() && record->second.last_write_time == last_write_time && record->second.size == size)
+      return record->second.digest;
+  }
+
+  const auto digest = hash_file(file_path);
+  if (!digest.has_value())
+    return std::nullopt;
+
+  std::lock_guard<std::mutex> lock(database_lock);
+  files[key] = { last_write_time, size, digest.value() };
+  is_dirty   = true;
+  return digest;
+}
+
+std::optional<uint64_t> task_database::get_input_digest(const std::string &target)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto digest = input_digests.find(target);
+  if (digest == input_digests.end())
+    return std::nullopt;
+  return digest->second;
+}
+
+void task_database::set_input_digest(const std::string &target, uint64_t digest)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto [item, inserted] = input_digests.insert({ target, digest });
+  if (!inserted && item->second == digest)
+    return;
+  item->second = digest;
+  is_dirty     = true;
+}
+
+std::optional<uint64_t> task_database::get_command_signature(const std::string &target)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto signature = command_signatures.find(target);
+  if (signature == command_signatures.end())
+    return std::nullopt;
+  return signature->second;
+}
+
+void task_database::set_command_signature(const std::string &target, uint64_t signature)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto [item, inserted] = command_signatures.insert({ target, signature });
+  if (!inserted && item->second == signature)
+    return;
+  item->second = signature;
+  is_dirty     = true;
+}
+
+/**
+ * @brief Returns the digest of what the recorded command signature of a target was rendered from
+ */
+std::optional<uint64_t> task_database::get_command_inputs(const std::string &target)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto digest = command_inputs.find(target);
+  if (digest == command_inputs.end())
+    return std::nullopt;
+  return digest->second;
+}
+
+void task_database::set_command_inputs(const std::string &target, uint64_t digest)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto [item, inserted] = command_inputs.insert({ target, digest });
+  if (!inserted && item->second == digest)
+    return;
+  item->second = digest;
+  is_dirty     = true;
+}
+
+/**
+ * @brief Returns the number of milliseconds the command of a target took when it last ran
+ */
+std::optional<uint64_t> task_database::get_duration(const std::string &target)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto duration = durations.find(target);
+  if (duration == durations.end())
+    return std::nullopt;
+  return duration->second;
+}
+
+void task_database::set_duration(const std::string &target, uint64_t duration)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto [item, inserted] = durations.insert({ target, duration });
+  if (!inserted && item->second == duration)
+    return;
+  item->second = duration;
+  is_dirty     = true;
+}
+
+/**
+ * @brief Returns the timestamp of the newest input a target was up to date with when its command last left it unchanged
+ */
+std::optional<int64_t> task_database::get_input_time(const std::string &target)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto input_time = input_times.find(target);
+  if (input_time == input_times.end())
+    return std::nullopt;
+  return input_time->second;
+}
+
+void task_database::set_input_time(const std::string &target, int64_t input_time)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto [item, inserted] = input_times.insert({ target, input_time });
+  if (!inserted && item->second == input_time)
+    return;
+  item->second = input_time;
+  is_dirty     = true;
+}
+
+/**
+ * @brief Returns the resources used by the processes of the command of a target when it last ran
+ */
+std::optional<process_usage> task_database::get_usage(const std::string &target)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  auto usage = usages.find(target);
+  if (usage == usages.end())
+    return std::nullopt;
+  return usage->second;
+}
+
+void task_database::set_usage(const std::string &target, const process_usage &usage)
+{
+  std::lock_guard<std::mutex> lock(database_lock);
+  usages[target] = usage;
+  is_dirty       = true;
+}
+} // namespace yakka
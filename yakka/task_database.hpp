@@ -1,12 +1,61 @@
+#pragma once
+
+#include "utilities.hpp"
 #include <string>
 #include <future>
 #include <optional>
+#include <mutex>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
 
 namespace yakka {
+/**
+ * @brief Persistent record of build state between runs.
+ *        Stores the content digest of every file that has been hashed, keyed on path, along with the timestamp and size
+ *        that were observed at the time. Also stores the digest of the inputs of each target from the last successful run
+ *        and the signature of the rendered command that produced it, along with a digest of what the command was rendered
+ *        from so it is only rendered again once that changes. Also stores how long that command took to run and the
+ *        resources its processes used.
+ *        Targets whose command left them unchanged record the newest input timestamp they are up to date with.
+ *        All accessors are thread-safe as they are called from taskflow worker threads.
+ */
 class task_database {
 public:
+  struct file_record {
+    int64_t last_write_time;
+    uintmax_t size;
+    uint64_t digest;
+  };
+
   task_database();
   void load(const std::string path);
   void save(const std::string path);
+
+  std::optional<uint64_t> file_digest(const std::filesystem::path &file_path);
+  std::optional<uint64_t> file_digest(const std::filesystem::path &file_path, uintmax_t size, int64_t last_write_time);
+  std::optional<uint64_t> get_input_digest(const std::string &target);
+  void set_input_digest(const std::string &target, uint64_t digest);
+  std::optional<uint64_t> get_command_signature(const std::string &target);
+  void set_command_signature(const std::string &target, uint64_t signature);
+  std::optional<uint64_t> get_command_inputs(const std::string &target);
+  void set_command_inputs(const std::string &target, uint64_t digest);
+  std::optional<uint64_t> get_duration(const std::string &target);
+  void set_duration(const std::string &target, uint64_t duration);
+  std::optional<int64_t> get_input_time(const std::string &target);
+  void set_input_time(const std::string &target, int64_t input_time);
+  std::optional<process_usage> get_usage(const std::string &target);
+  void set_usage(const std::string &target, const process_usage &usage);
+
+private:
+  std::mutex database_lock;
+  std::unordered_map<std::string, file_record> files;
+  std::unordered_map<std::string, uint64_t> input_digests;
+  std::unordered_map<std::string, uint64_t> command_signatures;
+  std::unordered_map<std::string, uint64_t> command_inputs;
+  std::unordered_map<std::string, uint64_t> durations;
+  std::unordered_map<std::string, int64_t> input_times;
+  std::unordered_map<std::string, process_usage> usages;
+  bool is_dirty;
 };
 } // namespace yakka
@@ -0,0 +1,379 @@
+#include "template_environment.hpp"
+#include "yakka_project.hpp"
+#include "utilities.hpp"
+#include "spdlog/spdlog.h"
+#include <mutex>
+#include <cassert>
+
+namespace yakka {
+static thread_local template_context *current_context = nullptr;
+static thread_local bool task_state_used              = false; // Set when a template reads state of the current blueprint or task
+static thread_local int render_depth                  = 0;     // Renders in progress on the current thread, the outermost holds the shared lock
+
+static bool has_template_syntax(const std::string &input)
+{
+  return input.find('{') != std::string::npos || input.find("##") != std::string::npos;
+}
+
+template_environment::context_scope::context_scope(template_context &context) : previous(current_context)
+{
+  current_context = &context;
+}
+
+template_environment::context_scope::~context_scope()
+{
+  current_context = previous;
+}
+
+template_environment &template_environment::get()
+{
+  static template_environment environment;
+  return environment;
+}
+
+/**
+ * @brief Returns the context of the current thread for callbacks that read the state of the blueprint or task
+ */
+template_context *template_environment::context()
+{
+  task_state_used = true;
+  return shared_context();
+}
+
+/**
+ * @brief Returns the context of the current thread for callbacks that only read state shared by all tasks
+ */
+template_context *template_environment::shared_context()
+{
+  if (current_context == nullptr)
+    throw std::runtime_error("Template function used outside of a blueprint");
+  return current_context;
+}
+
+std::optional<nlohmann::json> aggregate_cache::find(const std::string &path)
+{
+  std::shared_lock<std::shared_mutex> guard(lock);
+  const auto entry = entries.find(path);
+  if (entry == entries.end())
+    return std::nullopt;
+  return entry->second;
+}
+
+void aggregate_cache::insert(const std::string &path, const nlohmann::json &value)
+{
+  std::unique_lock<std::shared_mutex> guard(lock);
+  entries.try_emplace(path, value);
+}
+
+void aggregate_cache::clear()
+{
+  std::unique_lock<std::shared_mutex> guard(lock);
+  entries.clear();
+}
+
+/**
+ * @brief Collects the values at @p path of every component and of the project data
+ */
+static nlohmann::json compute_aggregate(const std::string &path_string, const nlohmann::json &summary)
+{
+  auto &env = template_environment::get();
+  nlohmann::json aggregate;
+  auto path = json_pointer(path_string);
+  // Loop through components, check if object path exists, if so add it to the aggregate
+  if (summary.contains("components"))
+    for (const auto &[c_key, c_value]: summary["components"].items()) {
+      if (!c_value.contains(path) || c_value[path].is_null())
+        continue;
+
+      auto v = c_value[path];
+      if (v.is_object())
+        for (const auto &[i_key, i_value]: v.items()) {
+          aggregate[i_key] = i_value;
+        }
+      else if (v.is_array())
+        for (const auto &[i_key, i_value]: v.items())
+          if (i_value.is_object())
+            aggregate.push_back(i_value);
+          else
+            aggregate.push_back(try_render(env, i_value.get<std::string>(), summary));
+      else if (!v.is_null())
+        aggregate.push_back(try_render(env, v.get<std::string>(), summary));
+    }
+
+  // Check project data
+  if (summary.contains("data") && summary["data"].contains(path)) {
+    auto v = summary["data"][path];
+    if (v.is_object())
+      for (const auto &[i_key, i_value]: v.items())
+        aggregate[i_key] = i_value;
+    else if (v.is_array())
+      for (const auto &i: v)
+        aggregate.push_back(env.render(i.get<std::string>(), summary));
+    else
+      aggregate.push_back(env.render(v.get<std::string>(), summary));
+  }
+  return aggregate;
+}
+
+template_environment::template_environment()
+{
+  add_common_template_commands(*this);
+
+  add_callback("store", 3, [](const inja::Arguments &args) {
+    if (args[0] && args[1]) {
+      nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
+      auto key                        = args[1]->get<std::string>();
+      context()->data_store[ptr][key] = *args[2];
+    }
+    return nlohmann::json{};
+  });
+  add_callback("store", 2, [](const inja::Arguments &args) {
+    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
+    context()->data_store[ptr] = *args[1];
+    return nlohmann::json{};
+  });
+  add_callback("push_back", 2, [](const inja::Arguments &args) {
+    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
+    auto &data_store = context()->data_store;
+    if (!data_store.contains(ptr)) {
+      data_store[ptr] = nlohmann::json::array();
+    }
+    data_store[ptr].push_back(*args[1]);
+    return nlohmann::json{};
+  });
+  add_callback("append", [](const inja::Arguments &args) {
+    const auto list = context()->list;
+    if (list == nullptr)
+      throw std::runtime_error("append() can only be used in a list");
+    if (args.size() == 1 && args[0]->is_array()) {
+      for (const auto &item: *args[0])
+        list->push_back(item.is_string() ? item.get<std::string>() : item.dump());
+      return std::string();
+    }
+    std::string item;
+    for (const auto &arg: args)
+      item.append(arg->is_string() ? arg->get_ref<const std::string &>() : arg->dump());
+    list->push_back(std::move(item));
+    return std::string();
+  });
+  add_callback("unique", 1, [](const inja::Arguments &args) {
+    nlohmann::json filtered;
+    std::copy_if(args[0]->cbegin(), args[0]->cend(), std::back_inserter(filtered), [&](const nlohmann::json &item) {
+      return std::find(filtered.begin(), filtered.end(), item.get<std::string>()) == filtered.end();
+    });
+    return filtered;
+  });
+  add_callback("fetch", 2, [](const inja::Arguments &args) {
+    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
+    auto key = args[1]->get<std::string>();
+    return context()->data_store[ptr][key];
+  });
+  add_callback("fetch", 1, [](const inja::Arguments &args) {
+    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
+    return context()->data_store[ptr];
+  });
+  add_callback("erase", 1, [](const inja::Arguments &args) {
+    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
+    context()->data_store[ptr].clear();
+    return nlohmann::json{};
+  });
+  add_callback("$", 1, [](const inja::Arguments &args) {
+    const auto match = context()->match;
+    const int index  = args[0]->get<int>();
+    if (match != nullptr && index >= 0 && static_cast<size_t>(index) < match->regex_matches.size())
+      return nlohmann::json(match->regex_matches[index]);
+    return nlohmann::json();
+  });
+  add_callback("reg", 1, [](const inja::Arguments &args) {
+    const auto match = context()->regex_match;
+    const int index  = args[0]->get<int>();
+    if (match != nullptr && index >= 0 && static_cast<size_t>(index) < match->size())
+      return nlohmann::json((*match)[index].str());
+    return nlohmann::json();
+  });
+  add_callback("curdir", 0, [](const inja::Arguments &args) {
+    return context()->curdir;
+  });
+  add_callback("render", 1, [](const inja::Arguments &args) {
+    return try_render(get(), args[0]->get<std::string>(), *shared_context()->summary);
+  });
+  add_callback("render", 2, [](const inja::Arguments &args) {
+    auto context              = shared_context();
+    auto backup               = context->curdir;
+    context->curdir           = args[1]->get<std::string>();
+    std::string render_output = try_render(get(), args[0]->get<std::string>(), *context->summary);
+    context->curdir           = backup;
+    return render_output;
+  });
+  add_callback("select", 1, [](const inja::Arguments &args) {
+    const auto &summary = *shared_context()->summary;
+    nlohmann::json choice;
+    for (const auto &option: args.at(0)->items()) {
+      const auto option_type = option.key();
+      const auto option_name = option.value();
+      if ((option_type == "feature" && summary.contains("features") && summary["features"].contains(option_name))
+          || (option_type == "component" && summary.contains("components") && summary["components"].contains(option_name))) {
+        assert(choice.is_null());
+        choice = option_name;
+      }
+    }
+    return choice;
+  });
+  add_callback("aggregate", 1, [](const inja::Arguments &args) {
+    const auto context = shared_context();
+    const auto path    = args[0]->get<std::string>();
+    if (context->aggregates == nullptr)
+      return compute_aggregate(path, *context->summary);
+
+    auto aggregate = context->aggregates->find(path);
+    if (aggregate.has_value())
+      return aggregate.value();
+
+    // Only keep aggregates that are the same for every task
+    const bool outer_state_used = task_state_used;
+    task_state_used             = false;
+    try {
+      aggregate = compute_aggregate(path, *context->summary);
+    } catch (...) {
+      task_state_used = true;
+      throw;
+    }
+    if (!task_state_used)
+      context->aggregates->insert(path, aggregate.value());
+    task_state_used = task_state_used || outer_state_used;
+    return aggregate.value();
+  });
+  add_callback("load_component", 1, [](const inja::Arguments &args) {
+    const auto project = shared_context()->project;
+    if (project == nullptr)
+      return nlohmann::json{};
+    const auto component_name     = args[0]->get<std::string>();
+    const auto component_location = project->workspace.find_component(component_name);
+    if (!component_location.has_value()) {
+      return nlohmann::json{};
+    }
+    auto [component_path, package_path] = component_location.value();
+    yakka::component new_component;
+    if (new_component.parse_file(component_path, package_path) == yakka::yakka_status::SUCCESS) {
+      return new_component.json;
+    } else {
+      return nlohmann::json{};
+    }
+  });
+}
+
+/**
+ * @brief Returns the parsed form of @p input, parsing it on first use
+ */
+const inja::Template &template_environment::parse_cached(const std::string &input)
+{
+  {
+    // A nested render already holds the shared lock of the outer render
+    std::shared_lock<std::shared_mutex> guard(lock, std::defer_lock);
+    if (render_depth == 0)
+      guard.lock();
+    const auto entry = templates.find(input);
+    if (entry != templates.end())
+      return *entry->second;
+  }
+
+  if (render_depth == 0)
+    return parse_locked(input);
+
+  // The outer render is waiting on a callback and holds no iterators, only references to parsed templates, which stay
+  // in place. It gives up its shared lock so the template can be parsed and takes it again afterwards.
+  struct relock {
+    std::shared_mutex &mutex;
+    ~relock()
+    {
+      mutex.lock_shared();
+    }
+  };
+  lock.unlock_shared();
+  relock relock_guard{ lock };
+  return parse_locked(input);
+}
+
+/**
+ * @brief Parses @p input under the exclusive lock, as parsing adds included templates to the template storage
+ */
+const inja::Template &template_environment::parse_locked(const std::string &input)
+{
+  std::unique_lock<std::shared_mutex> guard(lock);
+  const auto entry = templates.find(input);
+  if (entry != templates.end())
+    return *entry->second;
+  auto parsed_template = std::make_unique<inja::Template>(parse(input));
+  return *templates.emplace(input, std::move(parsed_template)).first->second;
+}
+
+/**
+ * @brief Parses @p input ahead of its first render. Errors are reported when the template is rendered.
+ */
+void template_environment::preload(const std::string &input)
+{
+  if (!has_template_syntax(input))
+    return;
+  try {
+    parse_cached(input);
+  } catch (std::exception &) {
+  }
+}
+
+std::string template_environment::render(const std::string &input, const nlohmann::json &data)
+{
+  // Text without any template syntax renders as itself
+  if (!has_template_syntax(input))
+    return input;
+  return render(parse_cached(input), data);
+}
+
+/**
+ * @brief Renders a template returned by @ref parse_cached. Included templates are looked up in the template storage
+ *        during the render, so the outermost render on a thread holds the lock shared until it completes.
+ */
+std::string template_environment::render(const inja::Template &parsed_template, const nlohmann::json &data)
+{
+  std::shared_lock<std::shared_mutex> guard(lock, std::defer_lock);
+  if (render_depth == 0)
+    guard.lock();
+  ++render_depth;
+  try {
+    auto output = inja::Environment::render(parsed_template, data);
+    --render_depth;
+    return output;
+  } catch (...) {
+    --render_depth;
+    throw;
+  }
+}
+
+/**
+ * @brief Renders @p input and returns the items passed to `append()` instead of the rendered text
+ */
+std::vector<std::string> template_environment::render_list(const std::string &input, const nlohmann::json &data)
+{
+  std::vector<std::string> items;
+  auto context  = shared_context();
+  auto previous = context->list;
+  context->list = &items;
+  try {
+    render(input, data);
+  } catch (...) {
+    context->list = previous;
+    throw;
+  }
+  context->list = previous;
+  return items;
+}
+
+std::string try_render(template_environment &env, const std::string &input, const nlohmann::json &data)
+{
+  try {
+    return env.render(input, data);
+  } catch (std::exception &e) {
+    spdlog::error("Template error: {}\n{}", input, e.what());
+    return "";
+  }
+}
+} // namespace yakka
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "inja.hpp"
+#include "nlohmann/json.hpp"
+#include <string>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace yakka {
+class project;
+struct blueprint_match;
+
+/**
+ * @brief Results of the `aggregate()` template function keyed by path.
+ *        An aggregate is computed on first use and kept until the project summary changes, which clears the cache.
+ *        Aggregates that use the state of a blueprint or task, such as `$()` or `curdir`, are not kept.
+ */
+class aggregate_cache {
+public:
+  std::optional<nlohmann::json> find(const std::string &path);
+  void insert(const std::string &path, const nlohmann::json &value);
+  void clear();
+
+private:
+  std::shared_mutex lock;
+  std::unordered_map<std::string, nlohmann::json> entries;
+};
+
+/**
+ * @brief State used by the template callbacks while a blueprint or task is rendered on the current thread.
+ */
+struct template_context {
+  const blueprint_match *match  = nullptr; // Provides the values of `$()`
+  std::string curdir;
+  nlohmann::json data_store;               // Values of `store()` and `fetch()`
+  std::vector<std::string> *list = nullptr; // Items of `append()` while a list is rendered
+  const nlohmann::json *summary = nullptr; // Data of nested renders and aggregates
+  yakka::project *project       = nullptr; // Only set while a task runs
+  aggregate_cache *aggregates   = nullptr;
+  const std::smatch *regex_match = nullptr; // Provides the values of `reg()` while a regex match is rendered
+};
+
+/**
+ * @brief Template environment shared by all threads. Every template is parsed once and the parsed template is kept.
+ *        inja binds callbacks when a template is parsed, so the callbacks that depend on the blueprint or task being
+ *        rendered look up the @ref template_context of the current thread, which is set with a @ref context_scope.
+ *        Rendering doesn't change the environment. Templates that include other templates parse them into the shared
+ *        template storage, which renders read, so renders hold the lock shared and parsing holds it exclusively.
+ */
+class template_environment : public inja::Environment {
+public:
+  /**
+   * @brief Makes @p context the context of the current thread until the scope ends
+   */
+  class context_scope {
+  public:
+    explicit context_scope(template_context &context);
+    context_scope(const context_scope &)            = delete;
+    context_scope &operator=(const context_scope &) = delete;
+    ~context_scope();
+
+  private:
+    template_context *previous;
+  };
+
+  static template_environment &get();
+  static template_context *context();
+
+  const inja::Template &parse_cached(const std::string &input);
+  std::string render(const inja::Template &parsed_template, const nlohmann::json &data);
+  void preload(const std::string &input);
+  std::string render(const std::string &input, const nlohmann::json &data);
+  std::vector<std::string> render_list(const std::string &input, const nlohmann::json &data);
+
+private:
+  template_environment();
+  static template_context *shared_context();
+  const inja::Template &parse_locked(const std::string &input);
+
+  std::shared_mutex lock;
+  std::unordered_map<std::string, std::unique_ptr<inja::Template>> templates;
+};
+
+std::string try_render(template_environment &env, const std::string &input, const nlohmann::json &data);
+} // namespace yakka
@@ -2,7 +2,8 @@
 #include "utilities.hpp"
 #include "subprocess.hpp"
 #include "spdlog/spdlog.h"
-#include "glob/glob.h"
+#include "directory_cache.hpp"
+#include "memory_admission.hpp"
 #include <concepts>
 #include <string_view>
 #include <expected>
@@ -13,6 +14,27 @@
 #include <algorithm>
 #include <iomanip>
 #include <filesystem>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <array>
+#include <format>
+#include <regex>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <csignal>
+#include <mutex>
+#include <unordered_set>
+extern char **environ;
+#endif
 
 namespace yakka {
 
@@ -23,17 +45,307 @@ if(0 == CreateProcess(argv[2], params, NULL, NULL, false, 0, NULL, NULL, &si, &p
         ShellExecute(NULL, "runas", argv[2], params, NULL, SW_SHOWNORMAL);
 }
 */
-std::pair<std::string, int> exec(const std::string &command_text, const std::string &arg_text)
+/**
+ * @brief Splits a command line into arguments following the quoting rules of a POSIX shell.
+ *        Returns std::nullopt if the command line uses any feature that needs a shell, such as pipes, redirection,
+ *        variable expansion, globbing, or command separators, so the caller can fall back to running it in a shell.
+ *
+ * @param command_line  Command line to split
+ * @return std::optional<std::vector<std::string>>  Arguments or std::nullopt if a shell is required
+ */
+std::optional<std::vector<std::string>> split_command_line(std::string_view command_line)
+{
+  std::vector<std::string> arguments;
+  std::string argument;
+  bool in_argument = false;
+
+  for (size_t i = 0; i < command_line.size(); ++i) {
+    const char c = command_line[i];
+    switch (c) {
+      case ' ':
+      case '\t':
+        if (in_argument) {
+          arguments.push_back(std::move(argument));
+          argument.clear();
+          in_argument = false;
+        }
+        break;
+
+      case '\'': {
+        const auto end = command_line.find('\'', i + 1);
+        if (end == std::string_view::npos)
+          return std::nullopt;
+        argument.append(command_line.substr(i + 1, end - i - 1));
+        in_argument = true;
+        i           = end;
+        break;
+      }
+
+      case '"':
+        for (++i; i < command_line.size() && command_line[i] != '"'; ++i) {
+          if (command_line[i] == '$' || command_line[i] == '`')
+            return std::nullopt;
+          // Within double quotes a backslash only escapes characters that are otherwise special
+          if (command_line[i] == '\\' && i + 1 < command_line.size() && std::strchr("\\\"$`", command_line[i + 1]) != nullptr)
+            ++i;
+          argument.push_back(command_line[i]);
+        }
+        if (i == command_line.size())
+          return std::nullopt;
+        in_argument = true;
+        break;
+
+      case '\\':
+        if (i + 1 == command_line.size() || command_line[i + 1] == '\n')
+          return std::nullopt;
+        argument.push_back(command_line[++i]);
+        in_argument = true;
+        break;
+
+      case '~':
+      case '#':
+        // Only special at the start of a word
+        if (!in_argument)
+          return std::nullopt;
+        argument.push_back(c);
+        break;
+
+      case '=':
+        // Variable assignments before the command
+        if (arguments.empty())
+          return std::nullopt;
+        argument.push_back(c);
+        in_argument = true;
+        break;
+
+      default:
+        if (std::strchr("|&;<>()$`*?[\n\r", c) != nullptr)
+          return std::nullopt;
+        argument.push_back(c);
+        in_argument = true;
+        break;
+    }
+  }
+
+  if (in_argument)
+    arguments.push_back(std::move(argument));
+
+  if (arguments.empty())
+    return std::nullopt;
+  return arguments;
+}
+
+/**
+ * @brief Finds an executable in the directories listed in the PATH environment variable.
+ *        Names that already contain a directory are returned unchanged.
+ */
+std::optional<std::string> find_executable(const std::string &name)
+{
+  if (name.empty() || name.find('/') != std::string::npos)
+    return std::nullopt;
+
+#if defined(_WIN64) || defined(_WIN32) || defined(__CYGWIN__)
+  return std::nullopt;
+#else
+  const char *path = std::getenv("PATH");
+  if (path == nullptr)
+    return std::nullopt;
+
+  for (const auto directory: std::views::split(std::string_view(path), ':')) {
+    const auto candidate = fs::path(std::string_view(directory.begin(), directory.end())) / name;
+    std::error_code ec;
+    if (fs::is_regular_file(candidate, ec) && ::access(candidate.c_str(), X_OK) == 0)
+      return fs::absolute(candidate).string();
+  }
+  return std::nullopt;
+#endif
+}
+
+/**
+ * @brief Replaces the program of a tool command with its absolute path so it is not searched for on every run.
+ *        Any arguments that are part of the tool are kept.
+ */
+std::string resolve_tool_path(const std::string &tool)
+{
+  const auto program_end = tool.find_first_of(" \t");
+  const auto program     = tool.substr(0, program_end);
+  if (program.find_first_of("'\"\\$") != std::string::npos)
+    return tool;
+
+  const auto resolved = find_executable(program);
+  if (!resolved.has_value())
+    return tool;
+
+  // Quote the path if it contains a space so it is still split correctly
+  const auto quoted_path = resolved->find(' ') == std::string::npos ? resolved.value() : "'" + resolved.value() + "'";
+  return program_end == std::string::npos ? quoted_path : quoted_path + tool.substr(program_end);
+}
+
+// Set while a @ref build_task_scope is active on the current thread
+static thread_local bool running_build_task           = false;
+static thread_local std::vector<std::string> *task_log = nullptr;
+
+build_task_scope::build_task_scope(std::vector<std::string> *log) : previous(running_build_task), previous_log(task_log)
+{
+  running_build_task = true;
+  task_log           = log;
+}
+
+build_task_scope::~build_task_scope()
+{
+  running_build_task = previous;
+  task_log           = previous_log;
+}
+
+/**
+ * @brief Adds @p message to the log of the build task running on the current thread, or logs it when there is none
+ */
+void log_task_message(const std::string &message)
 {
-  spdlog::info("{} {}", command_text, arg_text);
+  if (task_log != nullptr)
+    task_log->push_back(message);
+  else
+    spdlog::info("{}", message);
+}
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+// Process groups of the build tools started by spawn() that have not been reaped yet
+static std::mutex running_processes_lock;
+static std::unordered_set<pid_t> running_processes;
+static bool processes_terminated = false;
+
+/**
+ * @brief Runs a program directly with posix_spawn and passes its combined stdout and stderr to a handler.
+ *        Tools started for a build task run in their own process group so they can be terminated along with the
+ *        processes they start. Other tools, such as the git and curl calls of the workspace, stay in the process group
+ *        of yakka so they still receive Ctrl+C from the terminal.
+ *
+ * @param arguments  Program followed by its arguments
+ * @param handler    Called with each block of output as it is read
+ * @param usage      Set to the resources used by the program if not null
+ * @return int  Exit code of the program, the signal number if it was killed, or 127 if it could not be started
+ */
+static int spawn(const std::vector<std::string> &arguments, const std::function<void(std::string_view)> &handler, process_usage *usage)
+{
+  std::vector<char *> argv;
+  for (const auto &a: arguments)
+    argv.push_back(const_cast<char *>(a.c_str()));
+  argv.push_back(nullptr);
+
+  // The pipe must not be inherited by processes spawned concurrently from other threads
+  int output_pipe[2];
+#if defined(__linux__)
+  if (::pipe2(output_pipe, O_CLOEXEC) != 0)
+    return -1;
+#else
+  if (::pipe(output_pipe) != 0)
+    return -1;
+  ::fcntl(output_pipe[0], F_SETFD, FD_CLOEXEC);
+  ::fcntl(output_pipe[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, output_pipe[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, output_pipe[1], STDERR_FILENO);
+
+  const bool build_tool = running_build_task;
+  posix_spawnattr_t attributes;
+  posix_spawnattr_init(&attributes);
+  if (build_tool) {
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+  }
+
+  pid_t pid;
+  int spawn_result = 0;
+  bool cancelled   = false;
+  {
+    // No build tool starts once the running processes have been terminated
+    std::lock_guard<std::mutex> lock(running_processes_lock);
+    cancelled = build_tool && processes_terminated;
+    if (!cancelled) {
+      spawn_result = ::posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), environ);
+      if (spawn_result == 0 && build_tool)
+        running_processes.insert(pid);
+    }
+  }
+  posix_spawnattr_destroy(&attributes);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(output_pipe[1]);
+
+  if (cancelled) {
+    ::close(output_pipe[0]);
+    return -1;
+  }
+  if (spawn_result != 0) {
+    ::close(output_pipe[0]);
+    handler(std::format("{}: {}\n", arguments[0], std::strerror(spawn_result)));
+    return 127;
+  }
+  memory_admission::add_process(pid);
+
+  std::array<char, 65536> buffer;
+  while (true) {
+    const auto count = ::read(output_pipe[0], buffer.data(), buffer.size());
+    if (count > 0)
+      handler(std::string_view(buffer.data(), count));
+    else if (count == 0 || errno != EINTR)
+      break;
+  }
+  ::close(output_pipe[0]);
+
+  int status = 0;
+  rusage resources;
+  int wait_result;
+  while ((wait_result = ::wait4(pid, &status, 0, &resources)) < 0 && errno == EINTR)
+    ;
+  {
+    std::lock_guard<std::mutex> lock(running_processes_lock);
+    running_processes.erase(pid);
+  }
+  memory_admission::remove_process(pid);
+  if (wait_result < 0)
+    return -1;
+
+  if (usage != nullptr) {
+    // ru_maxrss is in kB on Linux but in bytes on macOS
+#if defined(__APPLE__)
+    usage->peak_memory = resources.ru_maxrss / 1024;
+#else
+    usage->peak_memory = resources.ru_maxrss;
+#endif
+    usage->cpu_time    = (resources.ru_utime.tv_sec + resources.ru_stime.tv_sec) * 1000 + (resources.ru_utime.tv_usec + resources.ru_stime.tv_usec) / 1000;
+    usage->read_bytes  = resources.ru_inblock * 512;
+    usage->write_bytes = resources.ru_oublock * 512;
+  }
+
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status);
+  if (WIFSIGNALED(status))
+    return WTERMSIG(status);
+  return -1;
+}
+#endif
+
+static std::pair<std::string, int> run_in_shell(const std::string &command_text, process_usage *usage = nullptr)
+{
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  // The shell is spawned like any other tool so it can be terminated with the build and its usage is recorded
+  std::string output_text;
+  const int retcode = spawn(
+    { "/bin/sh", "-c", command_text },
+    [&](std::string_view data) {
+      output_text.append(data);
+    },
+    usage);
+  return { output_text, retcode };
+#else
   try {
-    std::string command = command_text;
-    if (!arg_text.empty())
-      command += " " + arg_text;
 #if defined(__USING_WINDOWS__)
-    auto p = subprocess::Popen(command, subprocess::output{ subprocess::PIPE }, subprocess::error{ subprocess::STDOUT });
+    auto p = subprocess::Popen(command_text, subprocess::output{ subprocess::PIPE }, subprocess::error{ subprocess::STDOUT });
 #else
-    auto p      = subprocess::Popen(command, subprocess::shell{ true }, subprocess::output{ subprocess::PIPE }, subprocess::error{ subprocess::STDOUT });
+    auto p = subprocess::Popen(command_text, subprocess::shell{ true }, subprocess::output{ subprocess::PIPE }, subprocess::error{ subprocess::STDOUT });
 #endif
 #if defined(__USING_WINDOWS__)
     auto output  = p.communicate().first;
@@ -50,42 +362,123 @@ std::pair<std::string, int> exec(const std::string &command_text, const std::str
     spdlog::error("Exception while executing: {}\n{}", command_text, e.what());
     return { "", -1 };
   }
+#endif
+}
+
+/**
+ * @brief Runs a command in the shell and returns its combined stdout and stderr
+ */
+std::pair<std::string, int> exec_shell(const std::string &command_text)
+{
+  log_task_message(command_text);
+  return run_in_shell(command_text);
+}
+
+/**
+ * @brief Terminates the process groups of the tools started by @ref exec for build tasks that are still running and
+ *        stops @ref exec from starting more for build tasks until @ref reset_process_termination is called.
+ */
+void terminate_running_processes()
+{
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  std::lock_guard<std::mutex> lock(running_processes_lock);
+  processes_terminated = true;
+  for (const auto pid: running_processes)
+    ::kill(-pid, SIGTERM);
+#endif
+}
+
+void reset_process_termination()
+{
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  std::lock_guard<std::mutex> lock(running_processes_lock);
+  processes_terminated = false;
+#endif
+}
+
+/**
+ * @brief Runs a tool and returns its combined stdout and stderr.
+ *        The tool is started directly without a shell unless the command line needs one.
+ */
+std::pair<std::string, int> exec(const std::string &command_text, const std::string &arg_text, process_usage *usage)
+{
+  log_task_message(command_text + " " + arg_text);
+  std::string command = command_text;
+  if (!arg_text.empty())
+    command += " " + arg_text;
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  const auto arguments = split_command_line(command);
+  if (arguments.has_value()) {
+    std::string output_text;
+    const int retcode = spawn(
+      arguments.value(),
+      [&](std::string_view data) {
+        output_text.append(data);
+      },
+      usage);
+    return { output_text, retcode };
+  }
+#endif
+  return run_in_shell(command, usage);
 }
 
 int exec(const std::string &command_text, const std::string &arg_text, std::function<void(std::string &)> function)
 {
-  spdlog::info("{} {}", command_text, arg_text);
+  log_task_message(command_text + " " + arg_text);
+  std::string command = command_text;
+  if (!arg_text.empty())
+    command += " " + arg_text;
+
+  // Pass the output to the handler one line at a time
+  std::string line;
+  const auto flush_line = [&]() {
+    try {
+      function(line);
+    } catch (std::exception &e) {
+      spdlog::debug("exec() data processing threw exception '{}'for the following data:\n{}", e.what(), line);
+    }
+    line.clear();
+  };
+  const auto split_lines = [&](std::string_view data) {
+    for (const char c: data) {
+      line.push_back(c);
+      if (line.size() == 511 || c == '\r' || c == '\n')
+        flush_line();
+    }
+  };
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  // Commands that need a shell are spawned through /bin/sh so they can be terminated with the build
+  const auto arguments = split_command_line(command);
+  const int retcode    = spawn(arguments.value_or(std::vector<std::string>{ "/bin/sh", "-c", command }), split_lines, nullptr);
+  if (!line.empty())
+    flush_line();
+  return retcode;
+#else
   try {
-    std::string command = command_text;
-    if (!arg_text.empty())
-      command += " " + arg_text;
 #if defined(__USING_WINDOWS__)
     auto p = subprocess::Popen(command, subprocess::output{ subprocess::PIPE }, subprocess::error{ subprocess::STDOUT });
 #else
     auto p       = subprocess::Popen(command, subprocess::shell{ true }, subprocess::output{ subprocess::PIPE }, subprocess::error{ subprocess::STDOUT });
 #endif
     auto output = p.output();
-    std::array<char, 512> buffer;
-    size_t count = 0;
-    buffer.fill('\0');
     if (output != nullptr) {
-      while (1) {
-        buffer[count] = fgetc(output);
-        if (feof(output))
+      // Read whatever output is available rather than a character at a time
+      std::array<char, 4096> buffer;
+      while (true) {
+#if defined(__USING_WINDOWS__)
+        const auto count = _read(_fileno(output), buffer.data(), static_cast<unsigned int>(buffer.size()));
+#else
+        const auto count = ::read(fileno(output), buffer.data(), buffer.size());
+#endif
+        if (count > 0)
+          split_lines(std::string_view(buffer.data(), count));
+        else if (count == 0 || errno != EINTR)
           break;
-
-        if (count == buffer.size() - 1 || buffer[count] == '\r' || buffer[count] == '\n') {
-          std::string temp(buffer.data());
-          try {
-            function(temp);
-          } catch (std::exception &e) {
-            spdlog::debug("exec() data processing threw exception '{}'for the following data:\n{}", e.what(), temp);
-          }
-          buffer.fill('\0');
-          count = 0;
-        } else
-          ++count;
-      };
+      }
+      if (!line.empty())
+        flush_line();
     }
     auto retcode = p.wait();
 #if defined(__USING_WINDOWS__)
@@ -96,6 +489,73 @@ int exec(const std::string &command_text, const std::string &arg_text, std::func
     spdlog::error("Exception while executing: {}\n{}", command_text, e.what());
   }
   return -1;
+#endif
+}
+
+/**
+ * @brief Formats tool arguments as the contents of a response file, one argument per line.
+ *        On POSIX hosts the arguments are split with shell quoting rules and re-quoted with backslashes as GCC and Clang expect.
+ *        On Windows the arguments are kept as they are since the MSVC tools use the same quoting on the command line.
+ *
+ * @param arg_text  Rendered tool arguments
+ * @return std::optional<std::string>  Response file contents or std::nullopt if the arguments need a shell
+ */
+std::optional<std::string> format_response_file(const std::string &arg_text)
+{
+#if defined(_WIN64) || defined(_WIN32) || defined(__CYGWIN__)
+  return arg_text;
+#else
+  // Split the arguments as if they followed a command so an '=' in the first argument is not taken as a variable assignment
+  const auto arguments = split_command_line("tool " + arg_text);
+  if (!arguments.has_value() || arguments->size() < 2)
+    return std::nullopt;
+
+  std::string contents;
+  for (const auto &argument: arguments.value() | std::views::drop(1)) {
+    if (argument.empty())
+      contents.append("\"\"");
+    for (const char c: argument) {
+      if (std::isspace(static_cast<unsigned char>(c)) || c == '\\' || c == '"' || c == '\'')
+        contents.push_back('\\');
+      contents.push_back(c);
+    }
+    contents.push_back('\n');
+  }
+  return contents;
+#endif
+}
+
+/**
+ * @brief Writes a file only if its contents differ so the timestamp of an unchanged file is preserved.
+ *        The new contents are written to a temporary file and renamed into place.
+ *
+ * @return std::expected<bool, std::string>  true if the file was written, false if it already held the contents
+ */
+std::expected<bool, std::string> write_file_if_changed(const fs::path &path, std::string_view contents)
+{
+  std::error_code ec;
+  if (fs::file_size(path, ec) == contents.size() && !ec) {
+    std::string existing;
+    get_file_contents(path.string(), &existing);
+    if (existing == contents)
+      return false;
+  }
+
+  if (path.has_parent_path())
+    fs::create_directories(path.parent_path(), ec);
+  const auto temp_path = path.string() + ".yakka_tmp";
+  {
+    std::ofstream file(temp_path, std::ios_base::binary | std::ios_base::trunc);
+    if (!file.is_open())
+      return std::unexpected{ std::format("Cannot open '{}'", temp_path) };
+    file.write(contents.data(), contents.size());
+    if (!file.good())
+      return std::unexpected{ std::format("Cannot write '{}'", temp_path) };
+  }
+  fs::rename(temp_path, path, ec);
+  if (ec)
+    return std::unexpected{ std::format("Cannot rename '{}': {}", temp_path, ec.message()) };
+  return true;
 }
 
 bool yaml_diff(const YAML::Node &node1, const YAML::Node &node2)
@@ -216,6 +676,91 @@ std::string generate_project_name(const component_list_t &components, const feat
   return project_name;
 }
 
+/**
+ * @brief Splits a rendered flow sequence of plain values, such as `[a.o, b.o, ]`, without a YAML parser
+ *
+ * @param text  Rendered sequence including the brackets
+ * @return std::optional<std::vector<std::string>>  The items or nothing if the sequence needs a YAML parser, such as for
+ *                                                  quoted values, nested collections or values spanning lines
+ */
+std::optional<std::vector<std::string>> parse_flow_sequence(std::string_view text)
+{
+  if (text.size() < 2 || text.front() != '[' || text.back() != ']')
+    return std::nullopt;
+  text = text.substr(1, text.size() - 2);
+  if (text.find_first_of("\"'[]{}#\t\r\n") != std::string_view::npos)
+    return std::nullopt;
+
+  std::vector<std::string> items;
+  size_t start = 0;
+  while (start <= text.size()) {
+    auto end = text.find(',', start);
+    if (end == std::string_view::npos)
+      end = text.size();
+    auto item = text.substr(start, end - start);
+    start     = end + 1;
+
+    const auto first = item.find_first_not_of(' ');
+    if (first == std::string_view::npos) {
+      // Only the last item can be empty, which is a trailing comma
+      if (end != text.size())
+        return std::nullopt;
+      break;
+    }
+    item = item.substr(first, item.find_last_not_of(' ') - first + 1);
+
+    // Leave anything that YAML could read as something other than a plain value to the YAML parser
+    if (std::strchr("&*!|>%@`?:-", item.front()) != nullptr || item.back() == ':' || item.find(": ") != std::string_view::npos || item.find(" #") != std::string_view::npos)
+      return std::nullopt;
+    items.emplace_back(item);
+  }
+  return items;
+}
+
+/**
+ * @brief Returns the compiled form of a regex, compiling it only the first time the pattern is used.
+ *        Compiled regexes are kept for the life of the process and are shared by all threads.
+ *
+ * @param pattern  ECMAScript regex
+ * @return const std::regex&  The compiled regex. Throws std::regex_error if the pattern is invalid
+ */
+const std::regex &cached_regex(const std::string &pattern)
+{
+  static std::shared_mutex lock;
+  static std::unordered_map<std::string, std::unique_ptr<const std::regex>> regexes;
+  {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    const auto entry = regexes.find(pattern);
+    if (entry != regexes.end())
+      return *entry->second;
+  }
+
+  // Compile outside the lock so an invalid pattern throws without leaving an entry behind
+  auto compiled = std::make_unique<const std::regex>(pattern);
+  std::unique_lock<std::shared_mutex> guard(lock);
+  return *regexes.try_emplace(pattern, std::move(compiled)).first->second;
+}
+
+/**
+ * @brief Calls @p handler for each successive match of @p regex in @p text.
+ *        The search walks the text with iterators so no copies of the remaining text are made.
+ *        As with repeated searches of the remaining text, `^` matches at the start of each search.
+ */
+void for_each_regex_match(const std::string &text, const std::regex &regex, const std::function<void(const std::smatch &)> &handler)
+{
+  std::smatch match;
+  for (auto begin = text.cbegin(); std::regex_search(begin, text.cend(), match, regex);) {
+    handler(match);
+    begin = match.suffix().first;
+    // Step over empty matches so the search makes progress
+    if (match.length(0) == 0) {
+      if (begin == text.cend())
+        break;
+      ++begin;
+    }
+  }
+}
+
 /**
  * @brief Parses dependency files as output by GCC or Clang generating a vector of filenames as found in the named file
  *
@@ -224,28 +769,58 @@ std::string generate_project_name(const component_list_t &components, const feat
  */
 std::vector<std::string> parse_gcc_dependency_file(const std::string &filename)
 {
-  std::vector<std::string> dependencies;
-  std::ifstream infile(filename);
-
-  if (!infile.is_open())
+  std::string contents;
+  if (get_file_contents(filename, &contents) == 0)
     return {};
 
-  std::string line;
-
-  // Find and ignore the first line with the target. Typically "<target>: \"
-  do {
-    std::getline(infile, line);
-  } while (line.length() > 0 && line.find(':') == std::string::npos);
-
-  while (std::getline(infile, line, ' ')) {
-    if (line.empty() || line.compare("\\\n") == 0)
-      continue;
-    if (line.back() == '\n')
-      line.pop_back();
-    if (line.back() == '\r')
-      line.pop_back();
-    dependencies.push_back(line.starts_with("./") ? line.substr(line.find_first_not_of("/", 2)) : line);
+  std::vector<std::string> dependencies;
+  std::string token;
+  bool in_target = true;
+  const auto end_token = [&]() {
+    if (token.empty())
+      return true;
+    // Any further rules are the empty targets written by -MP
+    if (!in_target && token.back() == ':')
+      return false;
+    if (!in_target)
+      dependencies.push_back(token.starts_with("./") ? token.substr(token.find_first_not_of("/", 2)) : token);
+    token.clear();
+    return true;
+  };
+
+  for (size_t i = 0; i < contents.size(); ++i) {
+    const char c = contents[i];
+    if (c == '\\' && i + 1 < contents.size()) {
+      const char next = contents[i + 1];
+      // Line continuations separate tokens. Escaped spaces and hashes are part of a path
+      if (next == '\n' || (next == '\r' && i + 2 < contents.size() && contents[i + 2] == '\n')) {
+        if (!end_token())
+          break;
+        i += next == '\r' ? 2 : 1;
+        continue;
+      }
+      if (next == ' ' || next == '#') {
+        token.push_back(next);
+        ++i;
+        continue;
+      }
+      token.push_back(c);
+    } else if (c == '$' && i + 1 < contents.size() && contents[i + 1] == '$') {
+      token.push_back('$');
+      ++i;
+    } else if (std::isspace(static_cast<unsigned char>(c))) {
+      if (!end_token())
+        break;
+    } else if (in_target && c == ':' && (i + 1 == contents.size() || std::isspace(static_cast<unsigned char>(contents[i + 1])))) {
+      // Skip the target. Typically "<target>: <dependencies>". A ':' that is part of a Windows drive letter is followed by a slash
+      token.clear();
+      in_target = false;
+    } else {
+      token.push_back(c);
+    }
   }
+  if (!in_target && !token.empty() && token.back() != ':')
+    end_token();
 
   return dependencies;
 }
@@ -346,8 +921,8 @@ void add_common_template_commands(inja::Environment &inja_env)
     std::vector<std::string> string_args;
     for (const auto &i: args)
       string_args.push_back(i->get<std::string>());
-    for (auto &p: glob::rglob(string_args))
-      aggregate.push_back(p.generic_string());
+    for (auto &p: directory_cache::get().glob(string_args))
+      aggregate.push_back(std::filesystem::path(p).generic_string());
     return aggregate;
   });
   inja_env.add_callback("absolute_dir", 1, [](inja::Arguments &args) {
@@ -372,6 +947,7 @@ void add_common_template_commands(inja::Environment &inja_env)
   inja_env.add_callback("extension", 1, [](inja::Arguments &args) {
     return std::filesystem::path{ args.at(0)->get<std::string>() }.extension().string().substr(1);
   });
+  // The stat cache is only invalidated for the targets of tasks but tools can write other files, so read the filesystem
   inja_env.add_callback("filesize", 1, [](const inja::Arguments &args) {
     return fs::file_size(args[0]->get<std::string>());
   });
@@ -410,13 +986,13 @@ void add_common_template_commands(inja::Environment &inja_env)
   });
   inja_env.add_callback("replace", 3, [](const inja::Arguments &args) {
     auto input  = args[0]->get<std::string>();
-    auto target = std::regex(args[1]->get<std::string>());
-    auto match  = args[2]->get<std::string>();
+    const auto &target = cached_regex(args[1]->get<std::string>());
+    auto match         = args[2]->get<std::string>();
     return std::regex_replace(input, target, match);
   });
   inja_env.add_callback("regex_escape", 1, [](const inja::Arguments &args) {
     auto input = args[0]->get<std::string>();
-    const std::regex metacharacters(R"([\.\^\$\+\(\)\[\]\{\}\|\?])");
+    static const std::regex metacharacters(R"([\.\^\$\+\(\)\[\]\{\}\|\?])");
     return std::regex_replace(input, metacharacters, "\\$&");
   });
   inja_env.add_callback("split", 2, [](const inja::Arguments &args) {
@@ -453,134 +1029,59 @@ void add_common_template_commands(inja::Environment &inja_env)
   });
 }
 
-std::pair<std::string, int> run_command(const std::string target, construction_task *task, project *project)
+/**
+ * @brief Moves the arguments of a tool to a response file in the project output directory.
+ *        The file is named after the target and process step so it is only rewritten when the arguments change.
+ *
+ * @return std::optional<std::string>  Argument referencing the response file or std::nullopt to keep the arguments
+ */
+static std::optional<std::string> use_response_file(const std::string &target, size_t step, const std::string &arg_text, project *project)
 {
-  std::string captured_output = "";
-  inja::Environment inja_env  = inja::Environment();
-  auto &blueprint             = task->match;
-  std::string curdir_path     = blueprint->blueprint->parent_path;
-  nlohmann::json data_store;
-
-  add_common_template_commands(inja_env);
-
-  inja_env.add_callback("store", 3, [&](const inja::Arguments &args) {
-    if (args[0] && args[1]) {
-      nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
-      auto key             = args[1]->get<std::string>();
-      data_store[ptr][key] = *args[2];
-    }
-    return nlohmann::json{};
-  });
-  inja_env.add_callback("store", 2, [&](const inja::Arguments &args) {
-    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
-    data_store[ptr] = *args[1];
-    return nlohmann::json{};
-  });
-  inja_env.add_callback("push_back", 2, [&](const inja::Arguments &args) {
-    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
-    if (!data_store.contains(ptr)) {
-      data_store[ptr] = nlohmann::json::array();
-    }
-    data_store[ptr].push_back(*args[1]);
-    return nlohmann::json{};
-  });
-  inja_env.add_callback("unique", 1, [&](const inja::Arguments &args) {
-    nlohmann::json filtered;
-    std::copy_if(args[0]->cbegin(), args[0]->cend(), std::back_inserter(filtered), [&](const nlohmann::json &item) {
-      return std::find(filtered.begin(), filtered.end(), item.get<std::string>()) == filtered.end();
-    });
-    return filtered;
-  });
-
-  inja_env.add_callback("fetch", 2, [&](const inja::Arguments &args) {
-    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
-    auto key = args[1]->get<std::string>();
-    return data_store[ptr][key];
-  });
-  inja_env.add_callback("fetch", 1, [&](const inja::Arguments &args) {
-    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
-    return data_store[ptr];
-  });
-  inja_env.add_callback("erase", 1, [&](const inja::Arguments &args) {
-    nlohmann::json::json_pointer ptr{ args[0]->get<std::string>() };
-    data_store[ptr].clear();
-    return nlohmann::json{};
-  });
-  inja_env.add_callback("$", 1, [&blueprint](const inja::Arguments &args) {
-    return blueprint->regex_matches[args[0]->get<int>()];
-  });
-  inja_env.add_callback("curdir", 0, [&](const inja::Arguments &args) {
-    return curdir_path;
-  });
-  inja_env.add_callback("render", 1, [&](const inja::Arguments &args) {
-    return try_render(inja_env, args[0]->get<std::string>(), project->project_summary);
-  });
-  inja_env.add_callback("render", 2, [&curdir_path, &inja_env, &project](const inja::Arguments &args) {
-    auto backup               = curdir_path;
-    curdir_path               = args[1]->get<std::string>();
-    std::string render_output = try_render(inja_env, args[0]->get<std::string>(), project->project_summary);
-    curdir_path               = backup;
-    return render_output;
-  });
+  const auto contents = format_response_file(arg_text);
+  if (!contents.has_value())
+    return std::nullopt;
+
+  const auto filename = std::format("{}-{:08x}.rsp", fs::path(target).filename().string(), hash_combine(hash_bytes(target), step) & 0xFFFFFFFF);
+  const auto path     = fs::path(project->project_summary["project_output"].get<std::string>()) / "response_files" / filename;
+  const auto result   = write_file_if_changed(path, contents.value());
+  if (!result.has_value()) {
+    spdlog::warn("Failed to write response file for {}: {}", target, result.error());
+    return std::nullopt;
+  }
 
-  inja_env.add_callback("aggregate", 1, [&](const inja::Arguments &args) {
-    nlohmann::json aggregate;
-    auto path = json_pointer(args[0]->get<std::string>());
-    // Loop through components, check if object path exists, if so add it to the aggregate
-    for (const auto &[c_key, c_value]: project->project_summary["components"].items()) {
-      // auto v = json_path(c.value(), path);
-      if (!c_value.contains(path) || c_value[path].is_null())
-        continue;
+  const auto argument = "@" + path.generic_string();
+  return argument.find(' ') == std::string::npos ? argument : "\"" + argument + "\"";
+}
 
-      auto v = c_value[path];
-      if (v.is_object())
-        for (const auto &[i_key, i_value]: v.items()) {
-          aggregate[i_key] = i_value; //try_render(inja_env, i.second.as<std::string>(), project->project_summary, log);
-        }
-      else if (v.is_array())
-        for (const auto &[i_key, i_value]: v.items())
-          if (i_value.is_object())
-            aggregate.push_back(i_value);
-          else
-            aggregate.push_back(try_render(inja_env, i_value.get<std::string>(), project->project_summary));
-      else if (!v.is_null())
-        aggregate.push_back(try_render(inja_env, v.get<std::string>(), project->project_summary));
-    }
+// Built-in blueprint commands that start a process
+static const std::unordered_set<std::string> process_commands = { "execute", "shell" };
 
-    // Check project data
-    if (project->project_summary["data"].contains(path)) {
-      auto v = project->project_summary["data"][path];
-      if (v.is_object())
-        for (const auto &[i_key, i_value]: v.items())
-          aggregate[i_key] = i_value;
-      else if (v.is_array())
-        for (const auto &i: v)
-          aggregate.push_back(inja_env.render(i.get<std::string>(), project->project_summary));
-      else
-        aggregate.push_back(inja_env.render(v.get<std::string>(), project->project_summary));
-    }
-    return aggregate;
-  });
-  inja_env.add_callback("load_component", 1, [&](const inja::Arguments &args) {
-    const auto component_name     = args[0]->get<std::string>();
-    const auto component_location = project->workspace.find_component(component_name);
-    if (!component_location.has_value()) {
-      return nlohmann::json{};
-    }
-    auto [component_path, package_path] = component_location.value();
-    yakka::component new_component;
-    if (new_component.parse_file(component_path, package_path) == yakka::yakka_status::SUCCESS) {
-      return new_component.json;
-    } else {
-      return nlohmann::json{};
-    }
-  });
+std::pair<std::string, int> run_command(const std::string target, construction_task *task, project *project)
+{
+  std::string captured_output = "";
+  auto &inja_env              = template_environment::get();
+  auto &blueprint             = task->match;
+  template_context context;
+  context.match      = blueprint.get();
+  context.curdir     = blueprint->blueprint->parent_path;
+  context.summary    = &project->project_summary;
+  context.project    = project;
+  context.aggregates = &project->aggregate_cache;
+  template_environment::context_scope context_scope(context);
+  build_task_scope build_task(&task->log);
+
+  // In adaptive mode wait for the memory the command needed last time before taking a job token
+  const auto database_key   = target + "|" + blueprint->blueprint->target;
+  const auto previous_usage = project->task_database.get_usage(database_key);
+  const auto memory_ticket  = project->memory_admission.admit(previous_usage ? previous_usage->peak_memory : 0);
 
   std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
 
   // Note: A blueprint process is a sequence of maps
+  size_t step = 0;
   for (const auto &command_entry: blueprint->blueprint->process) {
     assert(command_entry.is_object());
+    ++step;
 
     if (command_entry.size() != 1) {
       spdlog::error("Command '{}' for target '{}' is malformed", command_entry.begin().key(), target);
@@ -604,21 +1105,28 @@ std::pair<std::string, int> run_command(const std::string target, construction_t
         // Apply template engine
         arg_text = try_render(inja_env, arg_text, project->project_summary);
 
-        auto [temp_output, temp_retcode] = exec(command_text, arg_text);
+        // Long argument lists are passed in a response file to tools that accept them
+        if (project->response_file_threshold != 0 && arg_text.size() > project->response_file_threshold && project->response_file_tools.contains(command_name))
+          arg_text = use_response_file(target, step, arg_text, project).value_or(arg_text);
+
+        // Hold a job token while the tool runs so tools that honour the jobserver share the job limit
+        process_usage step_usage;
+        const auto job_token             = project->jobserver.acquire();
+        auto [temp_output, temp_retcode] = exec(command_text, arg_text, &step_usage);
         retcode                          = temp_retcode;
+        task->usage.add(step_usage);
 
+        // The main thread shows the output once the task finishes so the outputs of tasks running at once don't interleave
+        task->output.append(temp_output);
         if (retcode != 0)
-          spdlog::error("Returned {}\n{}", retcode, temp_output);
-        if (retcode < 0)
           return { temp_output, retcode };
 
         captured_output = temp_output;
-        // Echo the output of the command
-        // TODO: Note this should be done by the main thread to ensure the outputs from multiple run_command instances don't overlap
-        spdlog::info(captured_output);
       }
       // Else check if it is a built-in command
       else if (project->blueprint_commands.contains(command_name)) {
+        // Only the built-in commands that start a process take a job token
+        const auto job_token              = process_commands.contains(command_name) ? project->jobserver.acquire() : jobserver::token(nullptr, 0, false);
         yakka::process_return test_result = project->blueprint_commands.at(command_name)(target, command.value(), captured_output, project->project_summary, inja_env);
         captured_output                   = test_result.result;
         retcode                           = test_result.retcode;
@@ -637,10 +1145,85 @@ std::pair<std::string, int> run_command(const std::string target, construction_t
 
   std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
   auto duration                                     = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-  spdlog::info("{}: {} milliseconds", target, duration);
+  log_task_message(std::format("{}: {} milliseconds", target, duration));
+  project->task_database.set_duration(database_key, duration);
+  if (task->usage.peak_memory != 0)
+    project->task_database.set_usage(database_key, task->usage);
   return { captured_output, 0 };
 }
 
+/**
+ * @brief Computes the signature of the command a task would run.
+ *        Each process step is rendered exactly as @ref run_command would render it and the result is hashed along with the
+ *        command name and, for external tools, the tool path. Steps that fail to render contribute their raw template.
+ *
+ * @param target   Target being built
+ * @param task     Task whose blueprint process is hashed
+ * @param project  Project providing the tools and summary
+ * @return uint64_t  Digest of the rendered process
+ */
+uint64_t command_signature(const std::string target, construction_task *task, project *project)
+{
+  auto &inja_env  = template_environment::get();
+  auto &blueprint = task->match;
+  template_context context;
+  context.match      = blueprint.get();
+  context.curdir     = blueprint->blueprint->parent_path;
+  context.summary    = &project->project_summary;
+  context.project    = project;
+  context.aggregates = &project->aggregate_cache;
+  template_environment::context_scope context_scope(context);
+  uint64_t signature = hash_bytes(target);
+
+  for (const auto &command_entry: blueprint->blueprint->process) {
+    if (!command_entry.is_object() || command_entry.size() != 1) {
+      signature = hash_combine(signature, hash_bytes(command_entry.dump()));
+      continue;
+    }
+
+    auto command                   = command_entry.begin();
+    const std::string command_name = command.key();
+    signature                      = hash_combine(signature, hash_bytes(command_name));
+
+    if (project->project_summary["tools"].contains(command_name))
+      signature = hash_combine(signature, hash_bytes(project->project_summary["tools"][command_name].dump()));
+
+    if (!command.value().is_string()) {
+      signature = hash_combine(signature, hash_bytes(command.value().dump()));
+      continue;
+    }
+
+    const auto &command_text = command.value().get_ref<const std::string &>();
+    try {
+      signature = hash_combine(signature, hash_bytes(inja_env.render(command_text, project->project_summary)));
+    } catch (std::exception &) {
+      signature = hash_combine(signature, hash_bytes(command_text));
+    }
+  }
+
+  return signature;
+}
+
+/**
+ * @brief Computes a digest of what the command of a task is rendered from: the summary, the target and its blueprint.
+ *        While the digest is unchanged the recorded signature of the command is used instead of rendering it again.
+ *        Template functions that read the filesystem are not covered, so a command that uses them only changes
+ *        signature once the summary or blueprint changes as well.
+ *
+ * @param target          Target being built
+ * @param task            Task whose blueprint is digested
+ * @param summary_digest  Digest of the project summary the command is rendered with
+ * @return uint64_t  Digest of the inputs of the command
+ */
+uint64_t command_inputs_digest(const std::string target, construction_task *task, uint64_t summary_digest)
+{
+  const auto &blueprint = task->match->blueprint;
+  uint64_t digest       = hash_combine(summary_digest, hash_bytes(target));
+  digest                = hash_combine(digest, hash_bytes(blueprint->target));
+  digest                = hash_combine(digest, hash_bytes(blueprint->parent_path));
+  return hash_combine(digest, hash_bytes(blueprint->process.dump()));
+}
+
 std::pair<std::string, int> download_resource(const std::string url, fs::path destination)
 {
   fs::path filename = destination / url.substr(url.find_last_not_of('/'));
@@ -750,5 +1333,275 @@ std::expected<bool, std::string> has_data_dependency_changed(
     }
 }
 
+/**
+ * @brief Checks whether the data referenced by a data dependency changed using the digests of two project summaries.
+ *        Behaves as the version taking the summaries themselves, without walking them.
+ */
+std::expected<bool, std::string> has_data_dependency_changed(std::string_view data_path, const summary_index &previous, const summary_index &current)
+{
+  if (data_path.empty() || data_path[0] != data_dependency_identifier)
+    return false;
+  if (data_path.size() < 2 || data_path[1] != '/')
+    return std::unexpected{ "Invalid path format: missing root separator" };
+  if (previous.empty())
+    return true;
+
+  const auto component_changed = [&](const std::string &component_name, const std::string &pointer) {
+    if (!previous.contains(component_name) || !current.contains(component_name))
+      return true;
+    return previous.find(component_name, pointer) != current.find(component_name, pointer);
+  };
+
+  if (data_path.size() > 2 && data_path[2] == data_wildcard_identifier) {
+    if (data_path.size() < 4 || data_path[3] != '/')
+      return std::unexpected{ "Data dependency malformed: " + std::string{ data_path } };
+    const std::string pointer{ data_path.substr(3) };
+    if (previous.wildcard_digest(pointer) == current.wildcard_digest(pointer))
+      return false;
+    // Components that were removed are not a change, so the components are compared once the digests differ
+    for (const auto &component_name: current.component_names())
+      if (component_changed(component_name, pointer))
+        return true;
+    return false;
+  }
+
+  const auto path_view     = data_path.substr(2);
+  const auto separator_pos = path_view.find_first_of('/');
+  if (separator_pos == std::string_view::npos)
+    return std::unexpected{ "Invalid path format: missing component separator" };
+  return component_changed(std::string{ path_view.substr(0, separator_pos) }, std::string{ path_view.substr(separator_pos) });
+}
+
+namespace {
+// XXH64 constants. See https://github.com/Cyan4973/xxHash for the reference implementation
+constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl64(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const unsigned char *p)
+{
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t read32(const unsigned char *p)
+{
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint64_t xxh64_round(uint64_t accumulator, uint64_t input)
+{
+  accumulator += input * prime64_2;
+  accumulator = rotl64(accumulator, 31);
+  return accumulator * prime64_1;
+}
+
+inline uint64_t xxh64_merge_round(uint64_t accumulator, uint64_t value)
+{
+  accumulator ^= xxh64_round(0, value);
+  return accumulator * prime64_1 + prime64_4;
+}
+
+/**
+ * @brief XXH64 state that takes the data in pieces so large inputs don't have to be held in memory
+ */
+class xxh64_state {
+public:
+  explicit xxh64_state(uint64_t seed) : v{ seed + prime64_1 + prime64_2, seed + prime64_2, seed, seed - prime64_1 }, seed(seed)
+  {
+  }
+
+  void update(std::string_view data)
+  {
+    const auto *p   = reinterpret_cast<const unsigned char *>(data.data());
+    const auto *end = p + data.size();
+    total_length += data.size();
+
+    // Stripes are 32 bytes so data is buffered until a stripe is complete
+    if (buffered + data.size() < stripe.size()) {
+      std::memcpy(stripe.data() + buffered, p, data.size());
+      buffered += data.size();
+      return;
+    }
+    if (buffered > 0) {
+      const auto fill = stripe.size() - buffered;
+      std::memcpy(stripe.data() + buffered, p, fill);
+      consume(stripe.data());
+      p += fill;
+      buffered = 0;
+    }
+    for (; p + stripe.size() <= end; p += stripe.size())
+      consume(p);
+    buffered = end - p;
+    std::memcpy(stripe.data(), p, buffered);
+  }
+
+  uint64_t digest() const
+  {
+    uint64_t hash;
+    if (total_length >= stripe.size()) {
+      hash = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+      for (const auto lane: v)
+        hash = xxh64_merge_round(hash, lane);
+    } else {
+      hash = seed + prime64_5;
+    }
+    hash += total_length;
+    return finalize(hash, stripe.data(), stripe.data() + buffered);
+  }
+
+private:
+  void consume(const unsigned char *p)
+  {
+    for (size_t i = 0; i < 4; ++i)
+      v[i] = xxh64_round(v[i], read64(p + i * 8));
+  }
+
+  static uint64_t finalize(uint64_t hash, const unsigned char *p, const unsigned char *end);
+
+  uint64_t v[4];
+  uint64_t seed;
+  uint64_t total_length = 0;
+  std::array<unsigned char, 32> stripe;
+  size_t buffered = 0;
+};
+
+/**
+ * @brief Mixes the remaining bytes of the last partial stripe into @p hash
+ */
+uint64_t xxh64_state::finalize(uint64_t hash, const unsigned char *p, const unsigned char *end)
+{
+  for (; p + 8 <= end; p += 8) {
+    hash ^= xxh64_round(0, read64(p));
+    hash = rotl64(hash, 27) * prime64_1 + prime64_4;
+  }
+  if (p + 4 <= end) {
+    hash ^= static_cast<uint64_t>(read32(p)) * prime64_1;
+    hash = rotl64(hash, 23) * prime64_2 + prime64_3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash ^= static_cast<uint64_t>(*p) * prime64_5;
+    hash = rotl64(hash, 11) * prime64_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= prime64_2;
+  hash ^= hash >> 29;
+  hash *= prime64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+} // namespace
+
+/**
+ * @brief Fast, non-cryptographic 64-bit digest (XXH64) used to detect content changes
+ */
+uint64_t hash_bytes(std::string_view data, uint64_t seed)
+{
+  xxh64_state state(seed);
+  state.update(data);
+  return state.digest();
+}
+
+uint64_t hash_combine(uint64_t seed, uint64_t value)
+{
+  return seed ^ (value + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2));
+}
+
+std::optional<uint64_t> hash_file(const fs::path &file_path)
+{
+  ::FILE *file = ::fopen(file_path.string().c_str(), "rb");
+  if (file == nullptr)
+    return std::nullopt;
+
+  // Hash the file a chunk at a time rather than reading all of it into memory
+  xxh64_state state(0);
+  std::array<char, 65536> buffer;
+  size_t count;
+  while ((count = ::fread(buffer.data(), 1, buffer.size(), file)) > 0)
+    state.update(std::string_view(buffer.data(), count));
+  ::fclose(file);
+
+  return state.digest();
+}
+
+/**
+ * @brief Generates a digest of the project summary data referenced by a data dependency.
+ *        Uses the same path syntax as has_data_dependency_changed(), including the '*' component wildcard
+ *
+ * @param data_path  Data dependency path. e.g. ':/component/flags/cpp/global'
+ * @param summary    Project summary
+ * @return uint64_t  Digest of the referenced data. Missing data contributes a fixed value
+ */
+uint64_t hash_data_dependency(std::string_view data_path, const nlohmann::json &summary)
+{
+  uint64_t digest = hash_bytes(data_path);
+  if (data_path.size() < 3 || data_path[0] != data_dependency_identifier || data_path[1] != '/' || !summary.contains("components"))
+    return digest;
+
+  const auto &components = summary["components"];
+  const auto hash_value  = [&](const std::string &component_name, const std::string &pointer_string) {
+    digest = hash_combine(digest, hash_bytes(component_name));
+    try {
+      const nlohmann::json::json_pointer pointer{ pointer_string };
+      if (components.contains(component_name) && components[component_name].contains(pointer))
+        digest = hash_combine(digest, hash_bytes(components[component_name][pointer].dump()));
+    } catch (std::exception &e) {
+      spdlog::debug("Cannot hash data dependency '{}': {}", data_path, e.what());
+    }
+  };
+
+  if (data_path[2] == data_wildcard_identifier) {
+    const std::string pointer_string{ data_path.substr(3) };
+    for (const auto &[component_name, value]: components.items())
+      hash_value(component_name, pointer_string);
+  } else {
+    const auto path_view     = data_path.substr(2);
+    const auto separator_pos = path_view.find_first_of('/');
+    if (separator_pos == std::string_view::npos)
+      return digest;
+    hash_value(std::string{ path_view.substr(0, separator_pos) }, std::string{ path_view.substr(separator_pos) });
+  }
+
+  return digest;
+}
+
+/**
+ * @brief Generates a digest of the data referenced by a data dependency from the digests of a project summary
+ */
+uint64_t hash_data_dependency(std::string_view data_path, const summary_index &summary)
+{
+  uint64_t digest = hash_bytes(data_path);
+  if (data_path.size() < 3 || data_path[0] != data_dependency_identifier || data_path[1] != '/')
+    return digest;
+
+  const auto hash_value = [&](const std::string &component_name, const std::string &pointer) {
+    digest            = hash_combine(digest, hash_bytes(component_name));
+    const auto result = summary.find(component_name, pointer);
+    if (result.has_value())
+      digest = hash_combine(digest, result.value());
+  };
+
+  if (data_path[2] == data_wildcard_identifier)
+    return hash_combine(digest, summary.wildcard_digest(std::string{ data_path.substr(3) }));
+
+  const auto path_view     = data_path.substr(2);
+  const auto separator_pos = path_view.find_first_of('/');
+  if (separator_pos == std::string_view::npos)
+    return digest;
+  hash_value(std::string{ path_view.substr(0, separator_pos) }, std::string{ path_view.substr(separator_pos) });
+  return digest;
+}
 
 } // namespace yakka
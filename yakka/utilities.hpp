@@ -2,11 +2,18 @@
 
 #include "yaml-cpp/yaml.h"
 #include "inja.hpp"
+#include "summary_index.hpp"
 #include <string>
 #include <string_view>
+#include <vector>
 #include <expected>
+#include <optional>
 #include <unordered_set>
 #include <filesystem>
+#include <algorithm>
+#include <functional>
+#include <regex>
+#include <cstdint>
 
 namespace fs = std::filesystem;
 
@@ -15,8 +22,54 @@ using component_list_t = std::unordered_set<std::string>;
 using feature_list_t   = std::unordered_set<std::string>;
 using command_list_t   = std::unordered_set<std::string>;
 
-std::pair<std::string, int> exec(const std::string &command_text, const std::string &arg_text);
+/**
+ * @brief Resources used by a process as reported by the operating system when it exits
+ */
+struct process_usage {
+  uint64_t peak_memory = 0; // Peak resident set size in kB
+  uint64_t cpu_time    = 0; // User and system time in milliseconds
+  uint64_t read_bytes  = 0; // Bytes read from storage, not counting the page cache
+  uint64_t write_bytes = 0; // Bytes written to storage
+
+  void add(const process_usage &other)
+  {
+    peak_memory = std::max(peak_memory, other.peak_memory);
+    cpu_time += other.cpu_time;
+    read_bytes += other.read_bytes;
+    write_bytes += other.write_bytes;
+  }
+};
+
+/**
+ * @brief Marks the tools started by @ref exec on the current thread as build tools until the scope ends.
+ *        Build tools run in their own process group and are stopped by @ref terminate_running_processes.
+ *        Messages passed to @ref log_task_message are added to @p log, when given, so the main thread can show them
+ *        with the output of the task.
+ */
+class build_task_scope {
+public:
+  explicit build_task_scope(std::vector<std::string> *log = nullptr);
+  build_task_scope(const build_task_scope &)            = delete;
+  build_task_scope &operator=(const build_task_scope &) = delete;
+  ~build_task_scope();
+
+private:
+  bool previous;
+  std::vector<std::string> *previous_log;
+};
+
+void log_task_message(const std::string &message);
+
+std::pair<std::string, int> exec(const std::string &command_text, const std::string &arg_text, process_usage *usage = nullptr);
+std::pair<std::string, int> exec_shell(const std::string &command_text);
+void terminate_running_processes();
+void reset_process_termination();
 int exec(const std::string &command_text, const std::string &arg_text, std::function<void(std::string &)> function);
+std::optional<std::vector<std::string>> split_command_line(std::string_view command_line);
+std::optional<std::string> find_executable(const std::string &name);
+std::string resolve_tool_path(const std::string &tool);
+std::optional<std::string> format_response_file(const std::string &arg_text);
+std::expected<bool, std::string> write_file_if_changed(const fs::path &path, std::string_view contents);
 bool yaml_diff(const YAML::Node &node1, const YAML::Node &node2);
 void json_node_merge(nlohmann::json &merge_target, const nlohmann::json &node);
 YAML::Node yaml_path(const YAML::Node &node, std::string path);
@@ -25,6 +78,9 @@ nlohmann::json::json_pointer json_pointer(std::string path);
 std::tuple<component_list_t, feature_list_t, command_list_t> parse_arguments(const std::vector<std::string> &argument_string);
 std::string generate_project_name(const component_list_t &components, const feature_list_t &features);
 std::vector<std::string> parse_gcc_dependency_file(const std::string &filename);
+std::optional<std::vector<std::string>> parse_flow_sequence(std::string_view text);
+const std::regex &cached_regex(const std::string &pattern);
+void for_each_regex_match(const std::string &text, const std::regex &regex, const std::function<void(const std::smatch &)> &handler);
 std::string component_dotname_to_id(const std::string dotname);
 fs::path get_yakka_shared_home();
 std::string try_render(inja::Environment &env, const std::string &input, const nlohmann::json &data);
@@ -36,9 +92,17 @@ std::expected<bool, std::string> has_data_dependency_changed(
     std::string_view data_path,
     const nlohmann::json& left,
     const nlohmann::json& right) noexcept;
+std::expected<bool, std::string> has_data_dependency_changed(std::string_view data_path, const summary_index &previous, const summary_index &current);
     
 void add_common_template_commands(inja::Environment &inja_env);
 
+// Content digests
+uint64_t hash_bytes(std::string_view data, uint64_t seed = 0);
+uint64_t hash_combine(uint64_t seed, uint64_t value);
+std::optional<uint64_t> hash_file(const fs::path &file_path);
+uint64_t hash_data_dependency(std::string_view data_path, const nlohmann::json &summary);
+uint64_t hash_data_dependency(std::string_view data_path, const summary_index &summary);
+
 template <class CharContainer> static size_t get_file_contents(const std::string &filename, CharContainer *container)
 {
   ::FILE *file = ::fopen(filename.c_str(), "rb");
@@ -27,6 +27,8 @@ blueprint::blueprint(const std::string &target, const nlohmann::json &blueprint,
             this->dependencies.push_back({ dependency::DATA_DEPENDENCY, d["data"].get<std::string>() });
         } else if (d.contains("dependency_file")) {
           this->dependencies.push_back({ dependency::DEPENDENCY_FILE_DEPENDENCY, d["dependency_file"].get<std::string>() });
+        } else if (d.contains("list")) {
+          this->dependencies.push_back({ dependency::LIST_DEPENDENCY, d["list"].get<std::string>() });
         }
       }
     }
@@ -36,5 +38,14 @@ blueprint::blueprint(const std::string &target, const nlohmann::json &blueprint,
 
   if (blueprint.contains("group"))
     this->task_group = blueprint["group"].get<std::string>();
+
+  if (blueprint.contains("resources")) {
+    if (blueprint["resources"].is_object())
+      for (auto &[pool, units]: blueprint["resources"].items())
+        this->resources[pool] = units.get<size_t>();
+    else
+      for (auto &pool: blueprint["resources"])
+        this->resources[pool.get<std::string>()] = 1;
+  }
 }
 } // namespace yakka
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <future>
 #include <optional>
 #include <filesystem>
+#include <map>
 
 #ifdef EXPERIMENTAL_FILESYSTEM
 namespace fs = std::experimental::filesystem;
@@ -16,7 +17,7 @@ namespace yakka {
 
 struct blueprint {
   struct dependency {
-    enum dependency_type { DEFAULT_DEPENDENCY, DATA_DEPENDENCY, DEPENDENCY_FILE_DEPENDENCY } type;
+    enum dependency_type { DEFAULT_DEPENDENCY, DATA_DEPENDENCY, DEPENDENCY_FILE_DEPENDENCY, LIST_DEPENDENCY } type;
     std::string name;
   };
   std::string target;
@@ -26,6 +27,7 @@ struct blueprint {
   nlohmann::json process;
   std::string parent_path;
   std::string task_group;
+  std::map<std::string, size_t> resources; // Units of each resource pool held while the blueprint runs
 
   blueprint(const std::string &target, const nlohmann::json &blueprint, const std::string &parent_path);
 };
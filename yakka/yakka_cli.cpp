@@ -1,6 +1,10 @@
 #include "yakka.hpp"
 #include "yakka_workspace.hpp"
 #include "yakka_project.hpp"
+#include "yakka_server.hpp"
+#include "file_watcher.hpp"
+#include "directory_cache.hpp"
+#include "yakka_schema.hpp"
 #include "utilities.hpp"
 #include "cxxopts.hpp"
 #include "subprocess.hpp"
@@ -18,14 +22,42 @@
 #include <chrono>
 #include <future>
 #include <algorithm>
+#include <format>
+#include <expected>
+#include <csignal>
+#include <cstring>
 
 using namespace indicators;
 using namespace std::chrono_literals;
 
-static void evaluate_project_dependencies(yakka::workspace &workspace, yakka::project &project);
+/**
+ * @brief Project the server evaluated for the last command that succeeded so running the same command again starts from its
+ *        target database. It is used while the component files, the directories and the summary it was loaded from are
+ *        unchanged.
+ */
+struct warm_project {
+  std::vector<std::string> key;
+  fs::file_time_type load_time;
+  std::vector<std::pair<fs::path, fs::file_time_type>> files;
+  std::unique_ptr<yakka::project> project;
+};
+
+static bool evaluate_project_dependencies(yakka::workspace &workspace, yakka::project &project);
 static void download_unknown_components(yakka::workspace &workspace, yakka::project &project);
 static void print_project_choice_errors(yakka::project &project);
 static void run_taskflow(yakka::project &project);
+static void setup_logging();
+static cxxopts::Options command_line_options();
+static int run_cli(yakka::workspace &workspace, int argc, char **argv, warm_project *warm = nullptr);
+static int serve_workspace();
+static std::expected<std::unique_ptr<yakka::project>, int> load_project(yakka::workspace &workspace, const cxxopts::ParseResult &result, const std::string &action, const std::vector<std::string> &arguments, bool start_build = true);
+static void configure_build(yakka::project &project, const cxxopts::ParseResult &result);
+static std::unique_ptr<warm_project> load_warm_project(yakka::workspace &workspace, const std::vector<std::string> &arguments);
+static std::unique_ptr<yakka::project> take_warm_project(warm_project *warm, const std::vector<std::string> &arguments);
+static void watch_project(std::unique_ptr<yakka::project> &project,
+                          fs::file_time_type last_run_start,
+                          const std::function<void(yakka::project &, fs::file_time_type)> &build,
+                          const std::function<std::unique_ptr<yakka::project>()> &load);
 
 tf::Task &create_tasks(yakka::project &project, const std::string &name, std::map<std::string, tf::Task> &tasks, tf::Taskflow &taskflow);
 static const semver::version yakka_version{
@@ -34,9 +66,38 @@ static const semver::version yakka_version{
 
 int main(int argc, char **argv)
 {
-  auto yakka_start_time = fs::file_time_type::clock::now();
+  // Let the server of the workspace run the command when asked to with --server or the environment variable
+  const char *server_setting = std::getenv(yakka::server::server_variable.c_str());
+  bool use_server            = server_setting != nullptr && std::string_view(server_setting) == "1";
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view argument(argv[i]);
+    if (argument == "--server")
+      use_server = true;
+    else if (argument == "--no-server" || argument == "serve") {
+      use_server = false;
+      break;
+    }
+  }
+  if (use_server) {
+    auto exit_code = yakka::server::forward_command(argc, argv, yakka_version.str());
+    if (exit_code.has_value())
+      return exit_code.value();
+  }
+
+  setup_logging();
+
+  // Create a workspace
+  yakka::workspace workspace;
+  workspace.init(".");
+
+  return run_cli(workspace, argc, argv);
+}
+
+static void setup_logging()
+{
+  // Loggers left by the server are replaced by ones using the streams of the current command
+  spdlog::drop_all();
 
-  // Setup logging
   std::error_code error_code;
   fs::remove("yakka.log", error_code);
 
@@ -61,11 +122,10 @@ int main(int argc, char **argv)
 
   auto yakkalog = std::make_shared<spdlog::logger>("yakkalog", spdlog::sinks_init_list{ console_error, file_log });
   spdlog::set_default_logger(yakkalog);
+}
 
-  // Create a workspace
-  yakka::workspace workspace;
-  workspace.init(".");
-
+static cxxopts::Options command_line_options()
+{
   cxxopts::Options options("yakka", "Yakka the embedded builder. Ver " + yakka_version.str());
   options.allow_unrecognised_options();
   options.positional_help("<action> [optional args]");
@@ -80,11 +140,29 @@ int main(int argc, char **argv)
                        ("d,data", "Additional data", cxxopts::value<std::string>())
                        ("no-slcc", "Ignore SLC files", cxxopts::value<bool>()->default_value("false"))
                        ("no-yakka", "Ignore Yakka files", cxxopts::value<bool>()->default_value("false"))
-                       ("action", "Select from 'register', 'list', 'update', 'git', 'remove', 'fetch' or a command", cxxopts::value<std::string>());
+                       ("content-hash", "Rebuild targets when the content of their inputs changes rather than their timestamps", cxxopts::value<bool>()->default_value("false"))
+                       ("cache", "Restore targets from the shared artifact cache. Implies --content-hash", cxxopts::value<bool>()->default_value("false"))
+                       ("cache-size", "Maximum size of the shared artifact cache in MB", cxxopts::value<uintmax_t>()->default_value("5120"))
+                       ("response-file-threshold", "Pass tool arguments longer than this many bytes in a response file. 0 disables response files", cxxopts::value<size_t>()->default_value("8192"))
+                       ("trace", "Write a Chrome trace of every build task to a file", cxxopts::value<std::string>())
+                       ("server", "Run the command in the Yakka server of the workspace if one is running. Also enabled by setting YAKKA_SERVER=1", cxxopts::value<bool>()->default_value("false"))
+                       ("no-server", "Run the command in this process even if YAKKA_SERVER=1 is set", cxxopts::value<bool>()->default_value("false"))
+                       ("j,jobs", "Number of jobs to run at once. Defaults to the jobserver of a parent make or the number of cores", cxxopts::value<size_t>()->default_value("0"))
+                       ("k,keep-going", "Keep building the targets that don't depend on a failed target. Stops after N failures when given, 0 for no limit", cxxopts::value<size_t>()->default_value("1")->implicit_value("0"))
+                       ("adaptive", "Only start a command when the memory it used in previous builds is available", cxxopts::value<bool>()->default_value("false"))
+                       ("action", "Select from 'register', 'list', 'update', 'git', 'remove', 'fetch', 'serve', 'watch' or a command", cxxopts::value<std::string>());
   // clang-format on
 
   options.parse_positional({ "action" });
-  auto result = options.parse(argc, argv);
+  return options;
+}
+
+static int run_cli(yakka::workspace &workspace, int argc, char **argv, warm_project *warm)
+{
+  auto yakka_start_time = fs::file_time_type::clock::now();
+
+  auto options = command_line_options();
+  auto result  = options.parse(argc, argv);
   if (result.count("help") || argc == 1) {
     std::cout << options.help() << std::endl;
     return 0;
@@ -121,8 +199,26 @@ int main(int argc, char **argv)
     return 0;
   }
 
-  auto action = result["action"].as<std::string>();
-  if (action == "register") {
+  auto action    = result["action"].as<std::string>();
+  auto arguments = result.unmatched();
+  bool watch     = false;
+  if (action == "watch") {
+    // The first command is the one that is watched
+    auto command = std::find_if(arguments.begin(), arguments.end(), [](const std::string &s) {
+      return !s.empty() && s.back() == '!';
+    });
+    if (command == arguments.end()) {
+      spdlog::error("Must provide a command to watch (commands end with !)");
+      return -1;
+    }
+    watch  = true;
+    action = *command;
+    arguments.erase(command);
+  }
+
+  if (action == "serve") {
+    return serve_workspace();
+  } else if (action == "register") {
     if (result.unmatched().size() == 0) {
       spdlog::error("Must provide URL of component registry");
       return -1;
@@ -207,13 +303,76 @@ int main(int argc, char **argv)
   // Action must be a command. Drop the !
   action.pop_back();
 
+  // Watch mode starts every project from the environment of the command
+  std::optional<std::string> makeflags;
+  if (watch) {
+    yakka::component_file_cache::get().enable();
+    if (const char *value = std::getenv("MAKEFLAGS"); value != nullptr)
+      makeflags = value;
+  }
+
+  // The server may already have the project of this command
+  auto project = watch ? nullptr : take_warm_project(warm, std::vector<std::string>(argv + 1, argv + argc));
+  if (project) {
+    configure_build(*project, result);
+  } else {
+    auto loaded = load_project(workspace, result, action, arguments);
+    if (!loaded)
+      return loaded.error();
+    project = std::move(loaded.value());
+  }
+
+  const auto build = [&](yakka::project &project, fs::file_time_type start_time) {
+    if (result.count("trace"))
+      project.trace.enable();
+
+    run_taskflow(project);
+
+    if (result.count("trace"))
+      project.trace.save(result["trace"].as<std::string>());
+
+    auto yakka_end_time = fs::file_time_type::clock::now();
+    std::cout << "Complete in " << std::chrono::duration_cast<std::chrono::milliseconds>(yakka_end_time - start_time).count() << " milliseconds" << std::endl;
+  };
+  build(*project, yakka_start_time);
+
+  if (watch) {
+    watch_project(project, yakka_start_time, build, [&]() {
+      if (makeflags.has_value())
+        ::setenv("MAKEFLAGS", makeflags->c_str(), 1);
+      else
+        ::unsetenv("MAKEFLAGS");
+      auto loaded = load_project(workspace, result, action, arguments);
+      return loaded ? std::move(loaded.value()) : nullptr;
+    });
+  }
+
+  spdlog::shutdown();
+  show_console_cursor(true);
+
+  if (!project || project->abort_build)
+    return -1;
+  else
+    return 0;
+}
+
+/**
+ * @brief Creates a project from the components, features, and commands on the command line, evaluates it, and generates
+ *        its target database
+ *
+ * @param start_build  False to only load the project, leaving the jobserver and the build options to be configured later
+ * @return The project or the exit code of the command on error
+ */
+static std::expected<std::unique_ptr<yakka::project>, int> load_project(yakka::workspace &workspace, const cxxopts::ParseResult &result, const std::string &action, const std::vector<std::string> &arguments, bool start_build)
+{
+
   // Process the command line options
   std::string project_name;
   std::string feature_suffix;
   std::vector<std::string> components;
   std::vector<std::string> features;
   std::unordered_set<std::string> commands;
-  for (auto s: result.unmatched()) {
+  for (auto s: arguments) {
     // Identify features, commands, and components
     if (s.front() == '+') {
       feature_suffix += s;
@@ -231,7 +390,7 @@ int main(int argc, char **argv)
 
   if (components.size() == 0) {
     spdlog::error("No components identified");
-    return -1;
+    return std::unexpected(-1);
   }
 
   // Remove the extra "-" and add the feature suffix
@@ -243,54 +402,60 @@ int main(int argc, char **argv)
     project_name = cli_set_project_name;
 
   // Create a project and output
-  yakka::project project(project_name, workspace);
+  auto project = std::make_unique<yakka::project>(project_name, workspace);
 
   // Move the CLI parsed data to the project
-  // project.unprocessed_components = std::move(components);
-  // project.unprocessed_features = std::move(features);
-  project.commands = std::move(commands);
+  // project->unprocessed_components = std::move(components);
+  // project->unprocessed_features = std::move(features);
+  project->commands = std::move(commands);
 
   // Add the action as a command
-  project.commands.insert(action);
+  project->commands.insert(action);
 
   // Init the project
-  project.init_project(components, features);
+  project->init_project(components, features);
+  project->content_hash_mode       = result["content-hash"].as<bool>();
+  project->response_file_threshold = result["response-file-threshold"].as<size_t>();
+  if (result["cache"].as<bool>()) {
+    project->content_hash_mode = true;
+    project->artifact_cache.init(workspace.yakka_shared_home / "cache", result["cache-size"].as<uintmax_t>() * 1024 * 1024);
+  }
 
   // Check if we don't want Yakka files
   if (result["no-yakka"].count() != 0) {
-    project.component_flags = yakka::component_database::flag::IGNORE_YAKKA;
+    project->component_flags = yakka::component_database::flag::IGNORE_YAKKA;
   }
 
   // Check if SLC needs to be supported
   if (result["no-slcc"].count() != 0) {
-    project.component_flags = yakka::component_database::flag::IGNORE_ALL_SLC;
+    project->component_flags = yakka::component_database::flag::IGNORE_ALL_SLC;
   } else {
     // Add SLC features
     if (result["with"].count() != 0) {
       const auto slc_features = result["with"].as<std::vector<std::string>>();
       for (const auto &f: slc_features)
-        project.slc_required.insert(f);
+        project->slc_required.insert(f);
     }
   }
 
   if (!result["no-eval"].as<bool>()) {
-    evaluate_project_dependencies(workspace, project);
+    if (!evaluate_project_dependencies(workspace, *project))
+      return std::unexpected(1);
 
-    if (!project.unknown_components.empty()) {
+    if (!project->unknown_components.empty()) {
       if (result["fetch"].as<bool>()) {
-        download_unknown_components(workspace, project);
+        download_unknown_components(workspace, *project);
       } else {
-        for (const auto &i: project.unknown_components)
+        for (const auto &i: project->unknown_components)
           spdlog::error("Missing component '{}'", i);
         spdlog::error("Try adding the '-f' command line option to automatically fetch components");
-        spdlog::shutdown();
-        exit(0);
+        return std::unexpected(0);
       }
     }
 
-    project.evaluate_choices();
-    if (!result["ignore-eval"].as<bool>() && (!project.incomplete_choices.empty() || !project.multiple_answer_choices.empty()))
-      print_project_choice_errors(project);
+    project->evaluate_choices();
+    if (!result["ignore-eval"].as<bool>() && (!project->incomplete_choices.empty() || !project->multiple_answer_choices.empty()))
+      print_project_choice_errors(*project);
   } else {
     spdlog::info("Skipping project evalutaion");
 
@@ -298,51 +463,51 @@ int main(int argc, char **argv)
       // Convert string to id
       const auto component_id = yakka::component_dotname_to_id(i);
       // Find the component in the project component database
-      auto component_location = workspace.find_component(component_id, project.component_flags);
+      auto component_location = workspace.find_component(component_id, project->component_flags);
       if (!component_location) {
         continue;
       }
 
       // Add component to the required list and continue if this is not a new component
       // Insert component and continue if this is not new
-      if (project.required_components.insert(component_id).second == false)
+      if (project->required_components.insert(component_id).second == false)
         continue;
 
       auto [component_path, package_path]             = component_location.value();
       std::shared_ptr<yakka::component> new_component = std::make_shared<yakka::component>();
       if (new_component->parse_file(component_path, package_path) == yakka::yakka_status::SUCCESS) {
-        project.components.push_back(new_component);
+        project->components.push_back(new_component);
       } else {
         if (!result["ignore-eval"].as<bool>()) {
           spdlog::error("Failed to parse {}", component_path.generic_string());
-          exit(-1);
+          return std::unexpected(-1);
         }
       }
     }
   }
 
   if (result["no-slcc"].count() == 0)
-    project.process_slc_rules();
+    project->process_slc_rules();
 
   // Project evaluation is complete
 
   // Print a list of required features
   spdlog::info("Required features:");
-  for (auto f: project.required_features)
+  for (auto f: project->required_features)
     spdlog::info("- {}", f);
 
   // Generate and save the summary
-  project.generate_project_summary();
-  project.save_summary();
+  project->generate_project_summary();
+  project->save_summary();
 
   auto t1 = std::chrono::high_resolution_clock::now();
-  project.validate_schema();
+  project->validate_schema();
   auto t2       = std::chrono::high_resolution_clock::now();
   auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
   spdlog::info("{}ms to validate schemas", duration);
 
-  if (project.current_state != yakka::project::state::PROJECT_VALID)
-    exit(-1);
+  if (project->current_state != yakka::project::state::PROJECT_VALID)
+    return std::unexpected(-1);
 
   // Insert additional command line data before processing blueprints
   if (result["data"].count() != 0) {
@@ -351,16 +516,16 @@ int main(int argc, char **argv)
     YAML::Node yaml_data       = YAML::Load(additional_data);
     nlohmann::json json_data   = yaml_data.as<nlohmann::json>();
     spdlog::info("Additional data: {}", json_data.dump());
-    yakka::json_node_merge(project.project_summary["data"], json_data);
+    yakka::json_node_merge(project->project_summary["data"], json_data);
   }
 
   t1 = std::chrono::high_resolution_clock::now();
-  project.process_blueprints();
+  project->process_blueprints();
 
   // Ensure all the commands have a blueprint
   spdlog::info("Checking for missing blueprints");
-  for (const auto &c: project.commands) {
-    if (project.blueprint_database.blueprints.contains(c))
+  for (const auto &c: project->commands) {
+    if (project->blueprint_database.blueprints.contains(c))
       continue;
 
     // Find a component that has that blueprint
@@ -373,7 +538,7 @@ int main(int argc, char **argv)
         if (component_paths) {
           auto [component_path, db_path] = component_paths.value();
           spdlog::info("Found a blueprint for {}: {}", c, component_path.string());
-          project.add_additional_tool(component_path);
+          project->add_additional_tool(component_path);
         } else {
           spdlog::error("Could not find component for blueprint: {}", c);
         }
@@ -381,44 +546,277 @@ int main(int argc, char **argv)
         spdlog::error("Multiple options for missing blueprint {}", c);
         for (const auto &o: blueprint_options)
           spdlog::error("- {}", o.get<std::string>());
-        return -1;
+        return std::unexpected(-1);
       }
     } else {
       spdlog::info("Did not find a blueprint for {}", c);
     }
   }
 
-  project.generate_target_database();
+  // The job count also limits the threads used to expand the targets
+  if (start_build)
+    configure_build(*project, result);
+  project->generate_target_database();
   t2 = std::chrono::high_resolution_clock::now();
 
   duration = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
   spdlog::info("{}ms to process blueprints", duration);
-  project.load_common_commands();
+  project->load_common_commands();
 
-  run_taskflow(project);
+  return project;
+}
 
-  auto yakka_end_time = fs::file_time_type::clock::now();
-  std::cout << "Complete in " << std::chrono::duration_cast<std::chrono::milliseconds>(yakka_end_time - yakka_start_time).count() << " milliseconds" << std::endl;
+/**
+ * @brief Starts the jobserver of the project and applies the command line options that control the build
+ */
+static void configure_build(yakka::project &project, const cxxopts::ParseResult &result)
+{
+  project.jobserver.init(result["jobs"].as<size_t>());
+  project.failure_limit = result["keep-going"].as<size_t>();
+  if (result["adaptive"].as<bool>())
+    project.memory_admission.enable();
+}
 
-  spdlog::shutdown();
-  show_console_cursor(true);
+static volatile std::sig_atomic_t watch_interrupted = 0;
 
-  if (project.abort_build)
-    return -1;
-  else
-    return 0;
+/**
+ * @brief Builds the project again whenever one of its input or component files changes, until interrupted.
+ *        Input changes rebuild with the targets already in memory. Component changes load the project again.
+ */
+static void watch_project(std::unique_ptr<yakka::project> &project,
+                          fs::file_time_type last_run_start,
+                          const std::function<void(yakka::project &, fs::file_time_type)> &build,
+                          const std::function<std::unique_ptr<yakka::project>()> &load)
+{
+  yakka::file_watcher watcher;
+  while (project) {
+    std::unordered_set<std::string> component_files;
+    for (const auto &c: project->components)
+      component_files.insert(c->file_path.string());
+    auto files = project->input_files();
+    files.insert(files.end(), component_files.begin(), component_files.end());
+    watcher.watch(files);
+    std::cout << "Watching " << files.size() << " files. Press Ctrl+C to stop" << std::endl;
+
+    // Ctrl+C stops a build as usual but only ends the watch while waiting
+    watch_interrupted = 0;
+    std::signal(SIGINT, [](int) {
+      watch_interrupted = 1;
+    });
+    std::vector<std::string> changes;
+    while (changes.empty() && !watch_interrupted)
+      changes = watcher.wait(250ms);
+    std::signal(SIGINT, SIG_DFL);
+    if (watch_interrupted)
+      return;
+
+    const auto start_time = fs::file_time_type::clock::now();
+    for (const auto &file: changes)
+      std::cout << file << " changed\n";
+    if (std::any_of(changes.begin(), changes.end(), [&](const std::string &file) {
+          return component_files.contains(file);
+        })) {
+      project.reset();
+      project = load();
+    } else {
+      project->prepare_rebuild(changes, last_run_start);
+    }
+
+    if (project)
+      build(*project, start_time);
+    last_run_start = start_time;
+  }
+}
+
+static fs::file_time_type file_timestamp(const fs::path &path)
+{
+  std::error_code ec;
+  const auto time = fs::last_write_time(path, ec);
+  return ec ? fs::file_time_type::min() : time;
 }
 
+/**
+ * @brief Identifies a command and the environment that changes how its project is evaluated
+ */
+static std::vector<std::string> command_key(const std::vector<std::string> &arguments)
+{
+  auto key = arguments;
+  key.push_back(fs::current_path().string());
+  for (const char *name: { "PATH", "HOME" }) {
+    const char *value = std::getenv(name);
+    key.push_back(value != nullptr ? std::format("{}={}", name, value) : "");
+  }
+  return key;
+}
+
+static bool is_current(const warm_project &warm)
+{
+  return std::all_of(warm.files.begin(), warm.files.end(), [](const auto &file) {
+    return file_timestamp(file.first) == file.second;
+  });
+}
+
+/**
+ * @brief Loads the project of a command in the server without building it.
+ *        The directory cache is cleared first so the directories listed afterwards are the ones the project depends on.
+ *
+ * @return The project or nullptr when the command doesn't build a project or its project cannot be kept
+ */
+static std::unique_ptr<warm_project> load_warm_project(yakka::workspace &workspace, const std::vector<std::string> &arguments)
+{
+  std::vector<std::string> argument_storage = { "yakka" };
+  argument_storage.insert(argument_storage.end(), arguments.begin(), arguments.end());
+  std::vector<char *> argv;
+  for (auto &argument: argument_storage)
+    argv.push_back(argument.data());
+
+  try {
+    auto options = command_line_options();
+    auto result  = options.parse(static_cast<int>(argv.size()), argv.data());
+    if (!result.count("action") || result["refresh"].as<bool>() || result["fetch"].as<bool>())
+      return nullptr;
+    auto action = result["action"].as<std::string>();
+    if (action.empty() || action.back() != '!')
+      return nullptr;
+    action.pop_back();
+
+    auto warm       = std::make_unique<warm_project>();
+    warm->key       = command_key(arguments);
+    warm->load_time = fs::file_time_type::clock::now();
+    yakka::directory_cache::get().clear();
+    auto loaded = load_project(workspace, result, action, result.unmatched(), false);
+    if (!loaded || !loaded.value()->unknown_components.empty())
+      return nullptr;
+    warm->project = std::move(loaded.value());
+
+    // A component file changed while it was being loaded may not have been parsed in its current state
+    for (const auto &c: warm->project->components) {
+      warm->files.push_back({ c->file_path, file_timestamp(c->file_path) });
+      if (warm->files.back().second >= warm->load_time)
+        return nullptr;
+    }
+    warm->files.push_back({ warm->project->summary_index_file, file_timestamp(warm->project->summary_index_file) });
+    for (const auto &[directory, last_write_time]: yakka::directory_cache::get().listed_directories())
+      warm->files.push_back({ directory, last_write_time });
+    return warm;
+  } catch (std::exception &e) {
+    spdlog::info("Not keeping the project: {}", e.what());
+    return nullptr;
+  }
+}
+
+/**
+ * @brief Takes the project the server loaded when it was loaded for the same command and nothing it was loaded from has
+ *        changed since
+ *
+ * @return The project ready to be built or nullptr
+ */
+static std::unique_ptr<yakka::project> take_warm_project(warm_project *warm, const std::vector<std::string> &arguments)
+{
+  if (warm == nullptr || !warm->project || warm->key != command_key(arguments) || !is_current(*warm))
+    return nullptr;
+
+  spdlog::info("Using the project loaded by the server");
+  auto project = std::move(warm->project);
+  project->prepare_loaded_build(warm->load_time);
+  return project;
+}
+
+/**
+ * @brief Runs the Yakka server of the workspace in the current directory.
+ *        The workspace is loaded again whenever its configuration or one of its component databases changes.
+ *        After a command succeeds the server loads its project so the next run of the command starts from it. Loading
+ *        happens between requests so the server doesn't accept new commands meanwhile, while the running ones continue.
+ */
+static int serve_workspace()
+{
+  std::unique_ptr<yakka::workspace> workspace;
+  std::unique_ptr<warm_project> warm;
+  std::vector<std::pair<fs::path, fs::file_time_type>> workspace_files;
+
+  // Commands start with the schemas already compiled
+  yakka::schema_validator::get();
+
+  const auto refresh = [&]() {
+    if (workspace && std::all_of(workspace_files.begin(), workspace_files.end(), [&](const auto &file) {
+          return file_timestamp(file.first) == file.second;
+        }))
+      return;
+
+    spdlog::info("Loading workspace");
+    warm.reset();
+    workspace = std::make_unique<yakka::workspace>();
+    workspace->init(".");
+
+    workspace_files.clear();
+    workspace_files.push_back({ workspace->workspace_path / "config.yaml", {} });
+    workspace_files.push_back({ workspace->local_database.get_path() / "yakka-components.json", {} });
+    workspace_files.push_back({ workspace->shared_database.get_path() / "yakka-components.json", {} });
+    for (const auto &db: workspace->package_databases)
+      workspace_files.push_back({ db.get_path() / "yakka-components.json", {} });
+    for (auto &file: workspace_files)
+      file.second = file_timestamp(file.first);
+  };
+
+  // Only commands run from the workspace with the environment of the server can be loaded by the server
+  const auto completed = [&](const std::vector<std::string> &arguments, const std::string &working_directory, const std::vector<std::string> &environment, int exit_code) {
+    if (exit_code != 0 || arguments.empty() || working_directory != fs::current_path().string())
+      return;
+    for (const char *name: { "PATH", "HOME" }) {
+      const char *value   = std::getenv(name);
+      const auto variable = std::find_if(environment.begin(), environment.end(), [&](const std::string &v) {
+        return v.starts_with(std::string(name) + "=");
+      });
+      if ((variable == environment.end()) != (value == nullptr) || (value != nullptr && variable->substr(std::strlen(name) + 1) != value))
+        return;
+    }
+
+    const std::vector<std::string> command(arguments.begin() + 1, arguments.end());
+    if (warm && warm->project && warm->key == command_key(command) && is_current(*warm))
+      return;
+
+    refresh();
+    const auto start = std::chrono::steady_clock::now();
+    auto loaded      = load_warm_project(*workspace, command);
+    if (!loaded)
+      return;
+    warm = std::move(loaded);
+    std::cout << "Loaded " << warm->project->project_name << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " milliseconds" << std::endl;
+  };
+
+  return yakka::server::serve(
+    yakka_version.str(),
+    refresh,
+    [&](int argc, char **argv) {
+      setup_logging();
+      return run_cli(*workspace, argc, argv, warm.get());
+    },
+    completed);
+}
+
+static volatile std::sig_atomic_t build_interrupted = 0;
+
 void run_taskflow(yakka::project &project)
 {
-  tf::Executor executor(std::min(32U, std::thread::hardware_concurrency()));
+  tf::Executor executor(project.jobserver.job_count());
+  yakka::reset_process_termination();
   project.todo_task_groups["Processing"] = std::make_shared<yakka::task_group>("Processing");
   auto finish                            = project.taskflow.emplace([&]() {
     // execution_progress = 100;
   });
+  project.prefetch_file_status();
+  // Commands are only rendered to check their signature when the summary they are rendered from changed
+  project.summary_digest = yakka::hash_bytes(project.project_summary.dump());
   for (auto &i: project.commands)
     project.create_tasks(i, finish);
 
+  project.prioritise_tasks();
+  if (!project.critical_path.empty()) {
+    spdlog::info("Estimated critical path: {} milliseconds", project.critical_path_duration);
+    for (const auto &i: project.critical_path)
+      spdlog::info("- {}", i);
+  }
+
   DynamicProgress<ProgressBar> task_progress_ui;
   std::vector<std::shared_ptr<ProgressBar>> task_progress_bars;
   for (auto &i: project.todo_task_groups) {
@@ -427,16 +825,58 @@ void run_taskflow(yakka::project &project)
     i.second->ui_id = task_progress_ui.push_back(*new_task_bar);
     task_progress_ui[i.second->ui_id].set_option(option::PostfixText{ std::to_string(i.second->current_count) + "/" + std::to_string(i.second->total_count) });
   }
+
+  // Estimate the remaining time from the durations recorded by previous runs
+  uint64_t completed_work_estimate = 0;
+  std::shared_ptr<ProgressBar> estimate_bar;
+  size_t estimate_ui_id = 0;
+  if (project.total_work_estimate > 0) {
+    estimate_bar = std::make_shared<ProgressBar>(option::BarWidth{ 50 }, option::ShowPercentage{ true }, option::PrefixText{ "Estimate" }, option::MaxProgress{ project.total_work_estimate });
+    task_progress_bars.push_back(estimate_bar);
+    estimate_ui_id = task_progress_ui.push_back(*estimate_bar);
+  }
   task_progress_ui.print_progress();
 
-  project.task_complete_handler = [&](std::shared_ptr<yakka::task_group> group) {
-    ++group->current_count;
-    // ++execution_progress;
-  };
+  // Ctrl+C stops the tools, which run in their own process groups, before Yakka exits
+  build_interrupted          = 0;
+  const auto previous_sigint = std::signal(SIGINT, [](int) {
+    build_interrupted = 1;
+  });
 
-  auto execution_future = executor.run(project.taskflow);
+  const auto start_time = std::chrono::steady_clock::now();
+  auto execution_future = executor.run(project.taskflow, [&]() {
+    project.task_events.notify();
+  });
 
-  do {
+  // The workers report finished tasks through a queue so only this thread writes their output and updates the progress.
+  // It also wakes periodically to update the estimate and to notice Ctrl+C
+  while (true) {
+    const bool finished = execution_future.wait_for(0ms) == std::future_status::ready;
+    while (auto event = project.task_events.pop()) {
+      for (const auto &message: event->log)
+        spdlog::info("{}", message);
+      if (event->retcode != 0) {
+        spdlog::error("{} returned {}\n{}", event->target, event->retcode, event->output);
+        continue;
+      }
+      if (!event->output.empty())
+        spdlog::info("{}", event->output);
+      ++event->task->group->current_count;
+      completed_work_estimate += event->task->estimated_duration;
+    }
+    if (build_interrupted && !project.abort_build) {
+      project.abort_build = true;
+      yakka::terminate_running_processes();
+    }
+    if (estimate_bar) {
+      // The build can't finish before the rest of the critical path or before the remaining work is shared among the workers
+      const auto elapsed        = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count());
+      const auto completed      = std::min<uint64_t>(completed_work_estimate, project.total_work_estimate);
+      const auto remaining_work = (project.total_work_estimate - completed) / executor.num_workers();
+      const auto remaining_path = project.critical_path_duration > elapsed ? project.critical_path_duration - elapsed : 0;
+      task_progress_ui[estimate_ui_id].set_option(option::PostfixText{ std::format("ETA {}s", (std::max(remaining_work, remaining_path) + 999) / 1000) });
+      task_progress_ui[estimate_ui_id].set_progress(completed);
+    }
     for (const auto &i: project.todo_task_groups) {
       if (i.second->current_count != i.second->last_progress_update) {
         task_progress_ui[i.second->ui_id].set_option(option::PostfixText{ std::to_string(i.second->current_count) + "/" + std::to_string(i.second->total_count) });
@@ -448,13 +888,39 @@ void run_taskflow(yakka::project &project)
         }
       }
     }
-  } while (execution_future.wait_for(500ms) != std::future_status::ready);
+    if (finished)
+      break;
+    project.task_events.wait_for(250ms);
+  }
 
   for (const auto &i: project.todo_task_groups) {
     task_progress_ui[i.second->ui_id].set_option(option::PostfixText{ std::to_string(i.second->current_count) + "/" + std::to_string(i.second->total_count) });
     task_progress_ui[i.second->ui_id].set_progress(i.second->current_count);
   }
+  if (estimate_bar && !project.abort_build) {
+    task_progress_ui[estimate_ui_id].set_option(option::PostfixText{ "ETA 0s" });
+    task_progress_ui[estimate_ui_id].mark_as_completed();
+  }
   task_progress_ui.print_progress();
+  std::signal(SIGINT, previous_sigint);
+
+  project.task_database.save(project.task_database_file);
+  project.save_build_report();
+
+  if (!project.failed_targets.empty()) {
+    std::cout << project.failed_targets.size() << " targets failed:\n";
+    for (const auto &target: project.failed_targets)
+      std::cout << "- " << target << "\n";
+    project.abort_build = true;
+  }
+  if (build_interrupted)
+    std::raise(SIGINT);
+
+  if (project.artifact_cache.is_enabled()) {
+    std::cout << "Artifact cache: " << project.artifact_cache.hits << " hits, " << project.artifact_cache.misses << " misses\n";
+    if (project.artifact_cache.stores > 0)
+      project.artifact_cache.trim();
+  }
 }
 
 static void download_unknown_components(yakka::workspace &workspace, yakka::project &project)
@@ -564,12 +1030,15 @@ static void download_unknown_components(yakka::workspace &workspace, yakka::proj
   spdlog::info("{}ms to download missing components", duration);
 }
 
-static void evaluate_project_dependencies(yakka::workspace &workspace, yakka::project &project)
+/**
+ * @return false if the project has an invalid component
+ */
+static bool evaluate_project_dependencies(yakka::workspace &workspace, yakka::project &project)
 {
   auto t1 = std::chrono::high_resolution_clock::now();
 
   if (project.evaluate_dependencies() == yakka::project::state::PROJECT_HAS_INVALID_COMPONENT)
-    exit(1);
+    return false;
 
   // If we're missing a component, update the component database and try again
   if (!project.unknown_components.empty()) {
@@ -583,6 +1052,7 @@ static void evaluate_project_dependencies(yakka::workspace &workspace, yakka::pr
   auto t2       = std::chrono::high_resolution_clock::now();
   auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
   spdlog::info("{}ms to process components", duration);
+  return true;
 }
 
 static void print_project_choice_errors(yakka::project &project)
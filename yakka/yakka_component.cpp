@@ -6,6 +6,58 @@
 using namespace semver::literals;
 
 namespace yakka {
+component_file_cache &component_file_cache::get()
+{
+  static component_file_cache cache;
+  return cache;
+}
+
+void component_file_cache::enable()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  enabled = true;
+}
+
+/**
+ * @brief Returns the content of a YAML file as JSON. Throws on parse errors like YAML::LoadFile.
+ */
+nlohmann::json component_file_cache::load(const fs::path &file_path)
+{
+  const auto path_string = file_path.generic_string();
+  if (!enabled)
+    return YAML::LoadFile(path_string).as<nlohmann::json>();
+
+  std::error_code ec;
+  const auto last_write_time = fs::last_write_time(file_path, ec);
+  const auto size            = fs::file_size(file_path, ec);
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto cached = entries.find(path_string);
+    if (cached != entries.end() && cached->second.last_write_time == last_write_time && cached->second.size == size)
+      return cached->second.json;
+  }
+
+  auto json = YAML::LoadFile(path_string).as<nlohmann::json>();
+  if (!ec) {
+    std::lock_guard<std::mutex> guard(lock);
+    entries[path_string] = { last_write_time, size, json };
+  }
+  return json;
+}
+
+/**
+ * @brief Paths of every cached file
+ */
+std::vector<fs::path> component_file_cache::paths()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::vector<fs::path> result;
+  result.reserve(entries.size());
+  for (const auto &[path, entry]: entries)
+    result.push_back(path);
+  return result;
+}
+
 yakka_status component::parse_file(fs::path file_path, fs::path package_path)
 {
   this->file_path         = file_path;
@@ -14,7 +66,7 @@ yakka_status component::parse_file(fs::path file_path, fs::path package_path)
   spdlog::info("Parsing '{}'", path_string);
 
   try {
-    json = YAML::LoadFile(path_string).as<nlohmann::json>();
+    json = component_file_cache::get().load(file_path);
   } catch (std::exception &e) {
     spdlog::error("Failed to load file: '{}'\n{}\n", path_string, e.what());
     std::cerr << "Failed to parse: " << path_string << "\n" << e.what() << "\n";
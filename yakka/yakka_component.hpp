@@ -7,9 +7,36 @@
 #include <string>
 #include <iostream>
 #include <filesystem>
+#include <mutex>
+#include <unordered_map>
 
 namespace yakka {
 
+/**
+ * @brief Parsed component files kept for the lifetime of the process.
+ *        Caching is off by default. When enabled, a file is only parsed again after its size or timestamp changes, which lets
+ *        a long running server skip the YAML parsing of components that did not change between commands.
+ */
+class component_file_cache {
+public:
+  static component_file_cache &get();
+
+  void enable();
+  nlohmann::json load(const fs::path &file_path);
+  std::vector<fs::path> paths();
+
+private:
+  struct entry {
+    fs::file_time_type last_write_time;
+    uintmax_t size;
+    nlohmann::json json;
+  };
+
+  bool enabled = false;
+  std::mutex lock;
+  std::unordered_map<std::string, entry> entries;
+};
+
 struct component {
   yakka_status parse_file(fs::path file_path, fs::path package_path = {});
   //std::tuple<component_list_t &, feature_list_t &> apply_feature(std::string feature_name);
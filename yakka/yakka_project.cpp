@@ -3,7 +3,8 @@
 #include "yakka_schema.hpp"
 #include "utilities.hpp"
 #include "spdlog/spdlog.h"
-#include "glob/glob.h"
+#include "directory_cache.hpp"
+#include "algorithm/for_each.hpp"
 #include <nlohmann/json-schema.hpp>
 #include <fstream>
 #include <chrono>
@@ -16,10 +17,18 @@ using namespace std::chrono_literals;
 
 project::project(const std::string project_name, yakka::workspace &workspace) : project_name(project_name), yakka_home_directory("/.yakka"), project_directory("."), workspace(workspace)
 {
-  abort_build      = false;
-  project_has_slcc = false;
-  current_state    = yakka::project::state::PROJECT_VALID;
-  component_flags  = component_database::flag::ALL_COMPONENTS;
+  abort_build             = false;
+  failure_limit           = 1;
+  project_has_slcc        = false;
+  content_hash_mode       = false;
+  response_file_threshold = 0;
+  critical_path_duration  = 0;
+  total_work_estimate     = 0;
+  current_state           = yakka::project::state::PROJECT_VALID;
+  component_flags         = component_database::flag::ALL_COMPONENTS;
+
+  blueprint_database.deps_log        = &deps_log;
+  blueprint_database.aggregate_cache = &aggregate_cache;
 
   add_common_template_commands(inja_environment);
 }
@@ -81,9 +90,12 @@ void project::init_project()
 {
   output_path          = yakka::default_output_directory + project_name;
   project_summary_file = output_path + "/yakka_summary.json";
-  // previous_summary["components"] = YAML::Node();
+  summary_index_file   = output_path + "/yakka_summary_index.json";
+  task_database_file   = output_path + "/yakka_task_database.json";
+  task_database.load(task_database_file);
 
   if (fs::exists(project_summary_file)) {
+    previous_summary_index.load(summary_index_file);
     project_summary_last_modified = fs::last_write_time(project_summary_file);
     std::ifstream i(project_summary_file);
     i >> project_summary;
@@ -97,6 +109,8 @@ void project::init_project()
     update_summary();
   } else
     fs::create_directories(output_path);
+
+  deps_log.open(output_path + "/.yakka_deps");
 }
 
 void project::process_requirements(std::shared_ptr<yakka::component> component, nlohmann::json child_node)
@@ -193,14 +207,10 @@ void project::update_summary()
 
     auto yakka_file = value["yakka_file"].get<std::string>();
 
+    // If so, process the component again. Data dependencies compare against the digests of its previous data
     if (!std::filesystem::exists(yakka_file) || std::filesystem::last_write_time(yakka_file) > project_summary_last_modified) {
-      // If so, move existing data to previous summary
-      previous_summary["components"][name] = value; // TODO: Verify this is correct way to do this efficiently
-      project_summary["components"][name]  = {};
+      project_summary["components"][name] = {};
       unprocessed_components.insert(name);
-    } else {
-      // Previous summary should point to the same object
-      previous_summary["components"][name] = value;
     }
   }
 }
@@ -617,8 +627,13 @@ void project::generate_project_summary()
         return std::filesystem::absolute(c->component_path).string();
       });
 
-      project_summary["tools"][key] = try_render(inja_env, value.get<std::string>(), project_summary);
+      project_summary["tools"][key] = resolve_tool_path(try_render(inja_env, value.get<std::string>(), project_summary));
     }
+    if (c->json.contains("response_files"))
+      for (const auto &tool: c->json["response_files"])
+        response_file_tools.insert(tool.get<std::string>());
+    if (c->json.contains("resource_pools"))
+      add_resource_pools(c->json["resource_pools"]);
   }
 
   project_summary["features"] = {};
@@ -653,16 +668,27 @@ void project::process_blueprints()
     process_blueprints(c);
 }
 
+/**
+ * @brief Expands the commands into the target database one breadth-first level at a time.
+ *        The targets of a level are matched in parallel on a taskflow executor sized to the job count. Each target writes
+ *        its matches into its own slot, and the slots are merged into the target database in order once the level is done.
+ *        Tools required by matched blueprints add blueprints and change the tools in the project summary, so they are only
+ *        added between matching passes, after which every new target of the level is matched again.
+ *        Unlike a serial expansion, where a tool is only seen by the targets after the one that required it, every new target
+ *        of a level is therefore matched with all the tools required by that level.
+ */
 void project::generate_target_database()
 {
-  std::vector<std::string> new_targets;
   std::unordered_set<std::string> processed_targets;
-  std::vector<std::string> unprocessed_targets;
+  std::vector<std::string> unprocessed_targets(commands.begin(), commands.end());
+  tf::Executor executor(jobserver.job_count());
 
-  for (const auto &c: commands)
-    unprocessed_targets.push_back(c);
+  // Aggregates are computed again for the current summary
+  aggregate_cache.clear();
 
   while (!unprocessed_targets.empty()) {
+    std::vector<std::string> level_targets;
+    std::vector<size_t> pending;
     for (const auto &t: unprocessed_targets) {
       // Add to processed targets and check if it's already been processed
       if (processed_targets.insert(t).second == false)
@@ -673,41 +699,60 @@ void project::generate_target_database()
         continue;
 
       // Check if target is not in the database. Note task_database is a multimap
-      if (target_database.targets.find(t) == target_database.targets.end()) {
-        const auto match = blueprint_database.find_match(t, this->project_summary);
-        for (const auto &m: match) {
-          // Add an entry to the database
-          target_database.targets.insert({ t, m });
-
-          // Check if the blueprint has additional requirements
-          if (m->blueprint->requirements.size() != 0)
-            for (const auto &t: m->blueprint->requirements) {
-              if (additional_tools.contains(t))
-                continue;
-              const auto p = workspace.find_component(t);
-              if (p.has_value()) {
-                auto [component_path, db_path] = p.value();
-                this->add_additional_tool(component_path);
-              }
+      if (target_database.targets.find(t) == target_database.targets.end())
+        pending.push_back(level_targets.size());
+      level_targets.push_back(t);
+    }
+
+    std::vector<std::vector<std::shared_ptr<blueprint_match>>> matches(level_targets.size());
+    while (!pending.empty()) {
+      // find_match only reads the blueprints and the project summary
+      tf::Taskflow match_flow;
+      match_flow.for_each(pending.begin(), pending.end(), [&](size_t i) {
+        matches[i] = blueprint_database.find_match(level_targets[i], this->project_summary);
+      });
+      executor.run(match_flow).wait();
+
+      // Check if the blueprints have additional requirements
+      const auto tool_count = additional_tools.size();
+      for (const auto i: pending)
+        for (const auto &m: matches[i])
+          for (const auto &t: m->blueprint->requirements) {
+            if (additional_tools.contains(t))
+              continue;
+            const auto p = workspace.find_component(t);
+            if (p.has_value()) {
+              auto [component_path, db_path] = p.value();
+              this->add_additional_tool(component_path);
             }
-        }
-      }
-      auto tasks = target_database.targets.equal_range(t);
+          }
+
+      // The blueprints and tool paths of new tools may change the matches of any target of the level
+      if (additional_tools.size() == tool_count)
+        break;
+      aggregate_cache.clear();
+    }
+
+    std::vector<std::string> new_targets;
+    for (size_t i = 0; i < level_targets.size(); ++i) {
+      const auto &t = level_targets[i];
+      for (const auto &m: matches[i])
+        target_database.targets.insert({ t, m });
 
+      auto tasks = target_database.targets.equal_range(t);
       std::for_each(tasks.first, tasks.second, [&new_targets](auto &i) {
         if (i.second)
           new_targets.insert(new_targets.end(), i.second->dependencies.begin(), i.second->dependencies.end());
       });
     }
 
-    unprocessed_targets.clear();
     unprocessed_targets.swap(new_targets);
   }
 }
 
 void project::load_common_commands()
 {
-  blueprint_commands["echo"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["echo"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     if (!command.is_null())
       captured_output = try_render(inja_env, command.get<std::string>(), generated_json);
 
@@ -715,7 +760,7 @@ void project::load_common_commands()
     return { captured_output, 0 };
   };
 
-  blueprint_commands["execute"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["execute"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     if (command.is_null())
       return { "", -1 };
     std::string temp = command.get<std::string>();
@@ -728,7 +773,7 @@ void project::load_common_commands()
       if (retcode != 0 && temp_output.length() != 0) {
         spdlog::error("\n{} returned {}\n{}", captured_output, retcode, temp_output);
       } else if (temp_output.length() != 0)
-        spdlog::info("{}", temp_output);
+        log_task_message(temp_output);
       return { temp_output, retcode };
     } catch (std::exception &e) {
       spdlog::error("Failed to execute: {}\n{}", temp, e.what());
@@ -737,7 +782,7 @@ void project::load_common_commands()
     }
   };
 
-  blueprint_commands["shell"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["shell"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     if (command.is_null())
       return { "", -1 };
     std::string temp = command.get<std::string>();
@@ -748,12 +793,12 @@ void project::load_common_commands()
       captured_output = inja_env.render(temp, generated_json);
 #endif
       spdlog::debug("Executing '{}' in a shell", captured_output);
-      auto [temp_output, retcode] = exec(captured_output, std::string(""));
+      auto [temp_output, retcode] = exec_shell(captured_output);
 
       if (retcode != 0 && temp_output.length() != 0) {
         spdlog::error("\n{} returned {}\n{}", captured_output, retcode, temp_output);
       } else if (temp_output.length() != 0)
-        spdlog::info("{}", temp_output);
+        log_task_message(temp_output);
       return { temp_output, retcode };
     } catch (std::exception &e) {
       spdlog::error("Failed to execute: {}\n{}", temp, e.what());
@@ -762,14 +807,34 @@ void project::load_common_commands()
     }
   };
 
-  blueprint_commands["fix_slashes"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["fix_slashes"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     std::replace(captured_output.begin(), captured_output.end(), '\\', '/');
     return { captured_output, 0 };
   };
 
-  blueprint_commands["regex"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["regex"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     assert(command.contains("search"));
-    std::regex regex_search(command["search"].get<std::string>());
+    const auto &regex_search = cached_regex(command["search"].get<std::string>());
+
+    // Renders the match template once for every match in the text. `reg()` returns a capture group of the match
+    auto render_matches = [&](const std::string &text) {
+      std::string output;
+      const auto match_string = command["match"].get<std::string>();
+      auto context            = template_environment::context();
+      auto previous           = context->regex_match;
+      try {
+        const auto &match_template = inja_env.parse_cached(match_string);
+        for_each_regex_match(text, regex_search, [&](const std::smatch &sm) {
+          context->regex_match = &sm;
+          output += inja_env.render(match_template, generated_json);
+        });
+      } catch (std::exception &e) {
+        spdlog::error("Template error: {}\n{}", match_string, e.what());
+      }
+      context->regex_match = previous;
+      return output;
+    };
+
     if (command.contains("split")) {
       std::istringstream ss(captured_output);
       std::string line;
@@ -780,18 +845,8 @@ void project::load_common_commands()
           std::string r = std::regex_replace(line, regex_search, command["replace"].get<std::string>(), std::regex_constants::format_no_copy);
           captured_output.append(r);
         } else if (command.contains("match")) {
-          std::smatch sm;
-          std::string new_output      = command.contains("prefix") ? command["prefix"].get<std::string>() : "";
-          inja::Environment local_env = inja_env; // Create copy and override `$()` function
-          const auto match_string     = command["match"].get<std::string>();
-          local_env.add_callback("reg", 1, [&](const inja::Arguments &args) {
-            return sm[args[0]->get<int>()].str();
-          });
-          for (; std::regex_search(captured_output, sm, regex_search);) {
-            // Render the match template
-            new_output += try_render(local_env, match_string, generated_json);
-            captured_output = sm.suffix();
-          }
+          std::string new_output = command.contains("prefix") ? command["prefix"].get<std::string>() : "";
+          new_output += render_matches(captured_output);
           if (command.contains("suffix"))
             new_output += command["suffix"].get<std::string>();
           captured_output = new_output;
@@ -815,14 +870,13 @@ void project::load_common_commands()
       }
     } else if (command.contains("to_yaml")) {
       YAML::Node yaml;
-      for (std::smatch sm; std::regex_search(captured_output, sm, regex_search);) {
+      for_each_regex_match(captured_output, regex_search, [&](const std::smatch &sm) {
         YAML::Node new_node;
         int i = 1;
         for (auto &v: command["to_yaml"])
           new_node[v.get<std::string>()] = sm[i++].str();
         yaml.push_back(new_node);
-        captured_output = sm.suffix();
-      }
+      });
 
       captured_output.erase();
 
@@ -835,22 +889,11 @@ void project::load_common_commands()
     } else if (command.contains("replace")) {
       captured_output = std::regex_replace(captured_output, regex_search, command["replace"].get<std::string>());
     } else if (command.contains("match")) {
-      std::smatch sm;
-      std::string new_output      = command.contains("prefix") ? command["prefix"].get<std::string>() : "";
-      inja::Environment local_env = inja_env; // Create copy and override `$()` function
-      const auto match_string     = command["match"].get<std::string>();
-      local_env.add_callback("reg", 1, [&](const inja::Arguments &args) {
-        return sm[args[0]->get<int>()].str();
-      });
-      for (; std::regex_search(captured_output, sm, regex_search);) {
-        // Render the match template
-        new_output += try_render(local_env, match_string, generated_json);
-        captured_output = sm.suffix();
-      }
+      std::string new_output = command.contains("prefix") ? command["prefix"].get<std::string>() : "";
+      new_output += render_matches(captured_output);
       if (command.contains("suffix"))
         new_output += command["suffix"].get<std::string>();
       captured_output = new_output;
-      //captured_output = std::regex_replace(captured_output, regex_search, command["match"].get<std::string>(), std::regex_constants::format_no_copy);
     } else {
       spdlog::error("'regex' command does not have enough information");
       return { "", -1 };
@@ -858,7 +901,7 @@ void project::load_common_commands()
     return { captured_output, 0 };
   };
 
-  blueprint_commands["inja"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["inja"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     try {
       std::string template_string;
       std::string template_filename;
@@ -902,7 +945,7 @@ void project::load_common_commands()
     return { captured_output, 0 };
   };
 
-  blueprint_commands["save"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["save"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     std::string save_filename;
 
     if (command.is_null())
@@ -910,27 +953,16 @@ void project::load_common_commands()
     else
       save_filename = try_render(inja_env, command.get<std::string>(), generated_json);
 
-    try {
-      std::ofstream save_file;
-      fs::path p(save_filename);
-      if (!p.parent_path().empty())
-        fs::create_directories(p.parent_path());
-      save_file.open(save_filename, std::ios_base::binary);
-      if (!save_file.is_open()) {
-        spdlog::error("Failed to save file: '{}'", save_filename);
-        return { "", -1 };
-      }
-      save_file << captured_output;
-      save_file.flush();
-      save_file.close();
-    } catch (std::exception &e) {
-      spdlog::error("Failed to save file: '{}'", save_filename);
+    // Identical content is not rewritten so the file keeps its timestamp and its dependents are not rebuilt
+    const auto result = write_file_if_changed(save_filename, captured_output);
+    if (!result.has_value()) {
+      spdlog::error("Failed to save file: '{}': {}", save_filename, result.error());
       return { "", -1 };
     }
     return { captured_output, 0 };
   };
 
-  blueprint_commands["create_directory"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["create_directory"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     if (!command.is_null()) {
       std::string filename = "";
       try {
@@ -948,7 +980,7 @@ void project::load_common_commands()
     return { "", 0 };
   };
 
-  blueprint_commands["verify"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["verify"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     std::string filename = command.get<std::string>();
     filename             = try_render(inja_env, filename, generated_json);
     if (fs::exists(filename)) {
@@ -960,11 +992,29 @@ void project::load_common_commands()
     return { "", -1 };
   };
 
-  blueprint_commands["rm"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["rm"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
+    // A list template names each file with append()
+    if (command.is_object() && command.contains("list")) {
+      try {
+        for (const auto &file: inja_env.render_list(command["list"].get<std::string>(), generated_json))
+          fs::remove(file);
+      } catch (std::exception &e) {
+        spdlog::error("Failed to apply template: {}\n{}", command.dump(), e.what());
+        return { "", -1 };
+      }
+      return { captured_output, 0 };
+    }
+
     std::string filename = command.get<std::string>();
     filename             = try_render(inja_env, filename, generated_json);
     // Check if the input was a YAML array construct
     if (filename.front() == '[' && filename.back() == ']') {
+      const auto files = parse_flow_sequence(filename);
+      if (files.has_value()) {
+        for (const auto &file: files.value())
+          fs::remove(file);
+        return { captured_output, 0 };
+      }
       // Load the generated dependency string as YAML and push each item individually
       try {
         auto file_list = YAML::Load(filename);
@@ -981,7 +1031,7 @@ void project::load_common_commands()
     return { captured_output, 0 };
   };
 
-  blueprint_commands["rmdir"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["rmdir"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     std::string path = command.get<std::string>();
     path             = try_render(inja_env, path, generated_json);
     // Put some checks here
@@ -993,7 +1043,7 @@ void project::load_common_commands()
     return { captured_output, 0 };
   };
 
-  blueprint_commands["pack"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["pack"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     std::vector<std::byte> data_output;
 
     if (!command.contains("data")) {
@@ -1062,7 +1112,7 @@ void project::load_common_commands()
     return { captured_output, 0 };
   };
 
-  blueprint_commands["copy"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["copy"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     std::string destination;
     nlohmann::json source;
     try {
@@ -1128,7 +1178,7 @@ void project::load_common_commands()
     return { "", 0 };
   };
 
-  blueprint_commands["cat"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["cat"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     std::string filename = try_render(inja_env, command.get<std::string>(), generated_json);
     std::ifstream datafile;
     datafile.open(filename, std::ios_base::in | std::ios_base::binary);
@@ -1139,23 +1189,23 @@ void project::load_common_commands()
     return { captured_output, 0 };
   };
 
-  blueprint_commands["new_project"] = [this](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["new_project"] = [this](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     const auto project_string = command.get<std::string>();
     yakka::project new_project(project_string, workspace);
     new_project.init_project(project_string);
     return { "", 0 };
   };
 
-  blueprint_commands["as_json"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["as_json"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     const auto temp_json = nlohmann::json::parse(captured_output);
     return { temp_json.dump(2), 0 };
   };
 
-  blueprint_commands["as_yaml"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["as_yaml"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     const auto temp_yaml = YAML::Load(captured_output);
     return { YAML::Dump(temp_yaml), 0 };
   };
-  blueprint_commands["diff"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, inja::Environment &inja_env) -> yakka::process_return {
+  blueprint_commands["diff"] = [](std::string target, const nlohmann::json &command, std::string captured_output, const nlohmann::json &generated_json, yakka::template_environment &inja_env) -> yakka::process_return {
     if (!command.is_object()) {
       spdlog::error("'diff' command invalid");
       return { "", -1 };
@@ -1183,6 +1233,18 @@ void project::load_common_commands()
   };
 }
 
+/**
+ * @brief Returns the timestamp of a target after its command has run.
+ *        A command that leaves its output unchanged, such as 'save' writing identical content, preserves the old timestamp
+ *        so the dependents of the target are not rebuilt. Targets that are not files use the current time.
+ */
+static fs::file_time_type output_timestamp(const std::string &target_name, yakka::stat_cache &stat_cache)
+{
+  stat_cache.invalidate(target_name);
+  const auto status = stat_cache.status(target_name);
+  return status.exists ? status.last_write_time : fs::file_time_type::clock::now();
+}
+
 void project::create_tasks(const std::string target_name, tf::Task &parent)
 {
   // XXX: Start time should be determined at the start of the executable and not here
@@ -1214,25 +1276,31 @@ void project::create_tasks(const std::string target_name, tf::Task &parent)
     if (target_name.front() == data_dependency_identifier) {
       task.data(&new_todo->second).work([=, this]() {
         // spdlog::info("{}: data", target_name);
+        build_trace::scope trace_scope(trace, target_name, "data");
         auto *d          = static_cast<construction_task *>(task.data());
-        auto result = has_data_dependency_changed(target_name, previous_summary, project_summary);
+        auto result = has_data_dependency_changed(target_name, previous_summary_index, project_summary_index);
         if (result) {
             d->last_modified = *result ? fs::file_time_type::max() : fs::file_time_type::min();
         } else {
             spdlog::error("Data dependency '{}' error: {}", target_name, result.error());
             return;
         }
+        if (content_hash_mode)
+          d->digest = hash_data_dependency(target_name, project_summary_index);
         if (d->last_modified > start_time)
           spdlog::info("{} has been updated", target_name);
         return;
       });
     }
     // Check if target name matches an existing file in filesystem
-    else if (fs::exists(target_name)) {
+    else if (stat_cache.exists(target_name)) {
       // Create a new task to retrieve the file timestamp
-      task.data(&new_todo->second).work([=]() {
+      task.data(&new_todo->second).work([=, this]() {
+        build_trace::scope trace_scope(trace, target_name, "stat");
         auto *d          = static_cast<construction_task *>(task.data());
-        d->last_modified = fs::last_write_time(target_name);
+        d->last_modified = stat_cache.last_write_time(target_name);
+        if (content_hash_mode)
+          d->digest = file_digest(target_name).value_or(0);
         //spdlog::info("{}: timestamp {}", target_name, (uint)d->last_modified.time_since_epoch().count());
         return;
       });
@@ -1267,30 +1335,89 @@ void project::create_tasks(const std::string target_name, tf::Task &parent)
         return;
       // spdlog::info("{}: process --- {}", target_name, task.hash_value());
       auto *d = static_cast<construction_task *>(task.data());
+      // When keeping going, targets that depend on a failed target are skipped
+      if (d->match && std::any_of(d->match->dependencies.begin(), d->match->dependencies.end(), [this](const std::string &dependency) {
+            const auto range = todo_list.equal_range(dependency);
+            return std::any_of(range.first, range.second, [](const auto &entry) {
+              return entry.second.failed;
+            });
+          })) {
+        d->failed = true;
+        return;
+      }
+      build_trace::scope trace_scope(trace, target_name, "process");
+      if (trace.is_enabled() && d->match)
+        trace_scope.args = { { "blueprint", d->match->blueprint->target }, { "group", d->group->name } };
       if (d->last_modified != fs::file_time_type::min()) {
         // I don't think this event happens. This check can probably be removed
         spdlog::info("{} already done", target_name);
         return;
       }
-      if (fs::exists(target_name)) {
-        d->last_modified = fs::last_write_time(target_name);
+      if (stat_cache.exists(target_name)) {
+        d->last_modified = stat_cache.last_write_time(target_name);
         // spdlog::info("{}: timestamp {}", target_name, (uint)d->last_modified.time_since_epoch().count());
       }
       if (d->match) {
+        // The signature of the rendered command is recorded per target so a target rebuilds when its command changes.
+        // Targets without a record are rebuilt as the command that produced them is unknown. The command is only rendered
+        // when the timestamps have not already decided the target and what it is rendered from changed since it was recorded
+        const auto database_key       = target_name + "|" + d->match->blueprint->target;
+        const bool has_process        = !d->match->blueprint->process.is_null();
+        const auto previous_signature = has_process ? task_database.get_command_signature(database_key) : std::nullopt;
+        const auto inputs_digest      = has_process && summary_digest.has_value() ? std::optional(yakka::command_inputs_digest(i->first, d, summary_digest.value())) : std::nullopt;
+        std::optional<uint64_t> signature;
+        const auto get_signature = [&]() {
+          if (!signature.has_value()) {
+            if (previous_signature.has_value() && inputs_digest.has_value() && task_database.get_command_inputs(database_key) == inputs_digest)
+              signature = previous_signature;
+            else
+              signature = yakka::command_signature(i->first, d, this);
+          }
+          return signature.value();
+        };
+        const auto command_changed = [&]() {
+          if (!has_process)
+            return false;
+          if (!previous_signature.has_value()) {
+            d->log.push_back(target_name + ": Updating because its command is not recorded");
+            return true;
+          }
+          if (previous_signature.value() == get_signature())
+            return false;
+          d->log.push_back(target_name + ": Updating because its command changed");
+          return true;
+        };
+        const auto record_signature = [&]() {
+          task_database.set_command_signature(database_key, get_signature());
+          if (inputs_digest.has_value())
+            task_database.set_command_inputs(database_key, inputs_digest.value());
+        };
+
         // Check if there are no dependencies
         if (d->match->dependencies.size() == 0) {
-          // If it doesn't exist as a file, run the command
-          if (!fs::exists(target_name)) {
-            auto result      = yakka::run_command(i->first, d, this);
-            d->last_modified = fs::file_time_type::clock::now();
+          // If it doesn't exist as a file or its command changed, run the command
+          if (!stat_cache.exists(target_name) || command_changed()) {
+            auto result                   = yakka::run_command(i->first, d, this);
+            d->last_modified              = output_timestamp(target_name, stat_cache);
+            trace_scope.args["exit_code"] = result.second;
+            if (d->usage.peak_memory != 0) {
+              trace_scope.args["peak_memory_kb"] = d->usage.peak_memory;
+              trace_scope.args["cpu_ms"]         = d->usage.cpu_time;
+            }
             if (result.second != 0) {
-              spdlog::info("Aborting: {} returned {}", target_name, result.second);
-              abort_build = true;
+              d->failed = true;
+              if (fail_target(target_name, result.second))
+                task_events.push({ target_name, d, std::move(d->output), result.second, std::move(d->log) });
               return;
             }
           }
-        } else if (!d->match->blueprint->process.is_null()) {
-          auto max_element = todo_list.end();
+          if (has_process)
+            record_signature();
+          if (content_hash_mode)
+            d->digest = file_digest(target_name).value_or(0);
+        } else if (has_process) {
+          auto max_element      = todo_list.end();
+          uint64_t input_digest = 0;
           for (auto j: d->match->dependencies) {
             auto temp         = todo_list.equal_range(j);
             auto temp_element = std::max_element(temp.first, temp.second, [](auto const &i, auto const &j) {
@@ -1300,42 +1427,377 @@ void project::create_tasks(const std::string target_name, tf::Task &parent)
             if (max_element == todo_list.end() || temp_element->second.last_modified > max_element->second.last_modified) {
               max_element = temp_element;
             }
+            if (content_hash_mode) {
+              input_digest = hash_combine(input_digest, hash_bytes(j));
+              for (auto k = temp.first; k != temp.second; ++k)
+                input_digest = hash_combine(input_digest, k->second.digest);
+            }
           }
           //spdlog::info("{}: Max element is {}", target_name, max_element->first);
-          if (!fs::exists(target_name) || max_element->second.last_modified.time_since_epoch() > d->last_modified.time_since_epoch()) {
-            spdlog::info("{}: Updating because of {}", target_name, max_element->first);
-            auto [output, retcode] = yakka::run_command(i->first, d, this);
-            d->last_modified       = fs::file_time_type::clock::now();
-            if (retcode < 0) {
-              spdlog::info("Aborting: {} returned {}", target_name, retcode);
-              abort_build = true;
+          const bool target_exists = stat_cache.exists(target_name);
+
+          // A target its command left unchanged keeps its old timestamp so compare against the newest input it is up to date with
+          auto up_to_date_time = d->last_modified;
+          if (target_exists && !content_hash_mode) {
+            const auto input_time = task_database.get_input_time(database_key);
+            if (input_time.has_value())
+              up_to_date_time = std::max(up_to_date_time, fs::file_time_type(fs::file_time_type::duration(input_time.value())));
+          }
+          bool update_required = !target_exists || max_element->second.last_modified.time_since_epoch() > up_to_date_time.time_since_epoch();
+
+          // With content hashes, only the digest of the inputs from the last successful run matters.
+          // Targets without a record fall back to the timestamp comparison
+          std::optional<uint64_t> previous_digest;
+          if (content_hash_mode && target_exists) {
+            previous_digest = task_database.get_input_digest(database_key);
+            if (previous_digest.has_value())
+              update_required = previous_digest.value() != input_digest;
+          }
+
+          if (update_required) {
+            if (previous_digest.has_value())
+              d->log.push_back(target_name + ": Updating because the content of its inputs changed");
+            else
+              d->log.push_back(target_name + ": Updating because of " + max_element->first);
+          } else {
+            update_required = command_changed();
+          }
+          // The artifact cache requires content hashes so the input digest covers every declared dependency
+          const auto cache_key = update_required && artifact_cache.is_enabled() ? hash_combine(get_signature(), input_digest) : 0;
+          if (update_required && artifact_cache.is_enabled()) {
+            const auto digest = [this](const std::string &path) {
+              return file_digest(path);
+            };
+            if (artifact_cache.restore(cache_key, target_name, d->match->dependency_files, digest)) {
+              d->log.push_back(target_name + ": Restored from cache");
+              stat_cache.invalidate(target_name);
+              trace_scope.args["cached"] = true;
+              update_required            = false;
+              d->last_modified           = fs::file_time_type::clock::now();
+            }
+          }
+
+          if (update_required) {
+            auto [output, retcode]        = yakka::run_command(i->first, d, this);
+            d->last_modified              = output_timestamp(target_name, stat_cache);
+            trace_scope.args["exit_code"] = retcode;
+            if (d->usage.peak_memory != 0) {
+              trace_scope.args["peak_memory_kb"] = d->usage.peak_memory;
+              trace_scope.args["cpu_ms"]         = d->usage.cpu_time;
+            }
+            if (retcode != 0) {
+              d->failed = true;
+              if (fail_target(target_name, retcode))
+                task_events.push({ target_name, d, std::move(d->output), retcode, std::move(d->log) });
               return;
             }
+            // Record the dependencies the compiler just listed so the next run doesn't parse them
+            for (const auto &dependency_file: d->match->dependency_files)
+              deps_log.dependencies(dependency_file);
+            // Dependents are not rebuilt when the target is unchanged. Changed data dependencies have no timestamp so use the current time
+            if (d->last_modified < max_element->second.last_modified)
+              task_database.set_input_time(database_key, std::min(max_element->second.last_modified, fs::file_time_type::clock::now()).time_since_epoch().count());
+            if (artifact_cache.is_enabled() && stat_cache.status(target_name).is_regular_file)
+              store_artifact(target_name, cache_key, d->match->dependency_files);
+          }
+          record_signature();
+          if (content_hash_mode) {
+            task_database.set_input_digest(database_key, input_digest);
+            d->digest = file_digest(target_name).value_or(input_digest);
           }
         } else {
           //spdlog::info("{} has no process", target_name);
+          if (content_hash_mode)
+            for (const auto &j: d->match->dependencies) {
+              auto temp = todo_list.equal_range(j);
+              for (auto k = temp.first; k != temp.second; ++k)
+                d->digest = hash_combine(d->digest, k->second.digest);
+            }
         }
       }
-      if (task_complete_handler) {
-        // spdlog::info("{} complete", target_name);
-        task_complete_handler(d->group);
-      }
-
+      task_events.push({ target_name, d, std::move(d->output), 0, std::move(d->log) });
       return;
     });
 
     new_todo->second.task = task;
     new_todo->second.task.precede(parent);
+    auto first_task = task;
+    if (i->second && !i->second->blueprint->process.is_null())
+      first_task = acquire_resource_pools(task, *i->second->blueprint);
 
     // For each dependency described in blueprint, retrieve or create task, add relationship, and add item to todo list
     if (i->second)
       for (auto &dep_target: i->second->dependencies)
-        create_tasks(dep_target.starts_with("./") ? dep_target.substr(dep_target.find_first_not_of("/", 2)) : dep_target, new_todo->second.task);
+        create_tasks(dep_target.starts_with("./") ? dep_target.substr(dep_target.find_first_not_of("/", 2)) : dep_target, first_task);
     // else
     //     spdlog::info("{} does not have blueprint match", i->first);
   }
 }
 
+/**
+ * @brief Queries the metadata of every target and dependency in the target database in parallel before the task graph
+ *        is built, rather than one file at a time as each task is created and run.
+ */
+void project::prefetch_file_status()
+{
+  std::vector<std::string> paths;
+  for (const auto &[target, match]: target_database.targets) {
+    paths.push_back(target);
+    if (match)
+      for (const auto &dependency: match->dependencies)
+        paths.push_back(dependency.starts_with("./") ? dependency.substr(dependency.find_first_not_of("/", 2)) : dependency);
+  }
+  std::erase_if(paths, [](const std::string &path) {
+    return path.empty() || path.front() == data_dependency_identifier;
+  });
+  stat_cache.prefetch(paths);
+}
+
+/**
+ * @brief Returns the content digest of a file, using the stat cache to decide whether the stored digest is still valid
+ */
+std::optional<uint64_t> project::file_digest(const std::string &path)
+{
+  const auto status = stat_cache.status(path);
+  if (!status.exists || !status.is_regular_file)
+    return std::nullopt;
+  return task_database.file_digest(path, status.size, status.last_write_time.time_since_epoch().count());
+}
+
+/**
+ * @brief Prioritises the tasks on the longest paths to the end of the build so long dependency chains and large
+ *        translation units start first instead of becoming the tail of the build.
+ *        The remaining time from each task is estimated from the durations recorded by previous runs. Commands without a
+ *        recorded duration are assumed to take the average. Taskflow has three priority levels, so tasks on paths of at
+ *        least half the critical path are high priority and tasks on paths shorter than a tenth of it are low priority.
+ */
+void project::prioritise_tasks()
+{
+  uint64_t recorded_total = 0;
+  size_t recorded_count   = 0;
+  for (auto &[name, todo]: todo_list) {
+    if (!todo.match || todo.match->blueprint->process.is_null())
+      continue;
+    const auto duration = task_database.get_duration(name + "|" + todo.match->blueprint->target);
+    if (duration.has_value()) {
+      todo.estimated_duration = duration.value();
+      recorded_total += duration.value();
+      ++recorded_count;
+    }
+  }
+
+  // Without any history there is nothing to prioritise on
+  if (recorded_count == 0)
+    return;
+
+  const auto average_duration = recorded_total / recorded_count;
+  std::unordered_map<size_t, const std::string *> task_names;
+  for (auto &[name, todo]: todo_list) {
+    task_names[todo.task.hash_value()] = &name;
+    if (todo.match && !todo.match->blueprint->process.is_null() && !task_database.get_duration(name + "|" + todo.match->blueprint->target).has_value())
+      todo.estimated_duration = average_duration;
+    total_work_estimate += todo.estimated_duration;
+  }
+
+  // Longest time from the start of each task to the end of the build, keyed on task
+  std::unordered_map<size_t, uint64_t> remaining;
+  std::function<uint64_t(tf::Task)> remaining_time = [&](tf::Task task) -> uint64_t {
+    const auto known = remaining.find(task.hash_value());
+    if (known != remaining.end())
+      return known->second;
+    uint64_t longest_successor = 0;
+    task.for_each_successor([&](tf::Task successor) {
+      longest_successor = std::max(longest_successor, remaining_time(successor));
+    });
+    const auto *d                = static_cast<construction_task *>(task.data());
+    const auto result            = longest_successor + (d != nullptr ? d->estimated_duration : 0);
+    remaining[task.hash_value()] = result;
+    return result;
+  };
+
+  tf::Task critical_start;
+  for (auto &[name, todo]: todo_list) {
+    const auto time = remaining_time(todo.task);
+    if (time > critical_path_duration) {
+      critical_path_duration = time;
+      critical_start         = todo.task;
+    }
+  }
+
+  for (auto &[name, todo]: todo_list) {
+    const auto time = remaining.at(todo.task.hash_value());
+    if (time * 2 >= critical_path_duration)
+      todo.task.priority(tf::TaskPriority::HIGH);
+    else if (time * 10 < critical_path_duration)
+      todo.task.priority(tf::TaskPriority::LOW);
+  }
+
+  // Follow the successors with the longest remaining time to find the critical path
+  for (auto task = critical_start; !task.empty();) {
+    const auto name = task_names.find(task.hash_value());
+    const auto *d   = static_cast<construction_task *>(task.data());
+    if (name != task_names.end() && d != nullptr && d->estimated_duration != 0)
+      critical_path.push_back(*name->second);
+    tf::Task next;
+    task.for_each_successor([&](tf::Task successor) {
+      if (next.empty() || remaining.at(successor.hash_value()) > remaining.at(next.hash_value()))
+        next = successor;
+    });
+    task = next;
+  }
+}
+
+/**
+ * @brief Adds a target to the artifact cache along with the digests of every dependency listed in its dependency files.
+ *        Targets with a dependency that cannot be hashed are not cached.
+ */
+void project::store_artifact(const std::string &target_name, uint64_t cache_key, const std::vector<std::string> &dependency_files)
+{
+  nlohmann::json discovered = nlohmann::json::object();
+  for (const auto &dependency_file: dependency_files)
+    for (const auto &dependency: deps_log.dependencies(dependency_file)) {
+      const auto digest = file_digest(dependency);
+      if (!digest.has_value())
+        return;
+      discovered[dependency] = digest.value();
+    }
+
+  artifact_cache.store(cache_key, target_name, dependency_files, discovered);
+}
+
+/**
+ * @brief Adds the resource pools declared by a component. When components declare the same pool the smallest capacity is used
+ */
+void project::add_resource_pools(const nlohmann::json &pools)
+{
+  for (const auto &[name, capacity]: pools.items()) {
+    const auto units     = std::max<size_t>(capacity.get<size_t>(), 1);
+    auto [pool, created] = resource_pool_capacities.insert({ name, units });
+    if (!created)
+      pool->second = std::min(pool->second, units);
+  }
+}
+
+/**
+ * @brief Makes a task hold units of the resource pools used by its blueprint while it runs.
+ *        A blueprint uses the pools listed in its resources and the pool named after its group, if there is one.
+ *        Tasks wait in Taskflow rather than on a worker thread until their units are available, so compiles keep running
+ *        while links or flash programming wait for a pool.
+ * @return The task that the dependencies of the blueprint must precede
+ */
+tf::Task project::acquire_resource_pools(tf::Task task, const blueprint &blueprint)
+{
+  auto resources = blueprint.resources;
+  if (!blueprint.task_group.empty() && resource_pool_capacities.contains(blueprint.task_group))
+    resources.insert({ blueprint.task_group, 1 });
+
+  // Resources are ordered by pool name so every task gathers units of its pools in the same order
+  std::vector<resource_pool::request> requests;
+  for (const auto &[name, units]: resources) {
+    const auto capacity = resource_pool_capacities.find(name);
+    if (capacity == resource_pool_capacities.end()) {
+      if (resource_pool_warnings.insert(blueprint.target + "|" + name).second)
+        spdlog::warn("Blueprint '{}' uses undeclared resource pool '{}'", blueprint.target, name);
+      continue;
+    }
+
+    // A task needing more than the whole pool would never run, so it takes the whole pool instead
+    if (units > capacity->second && resource_pool_warnings.insert(blueprint.target + "|" + name).second)
+      spdlog::warn("Blueprint '{}' uses {} units of resource pool '{}' which only has {}", blueprint.target, units, name, capacity->second);
+    auto &pool = resource_pools.try_emplace(name, capacity->second).first->second;
+    requests.push_back({ &pool, units });
+  }
+  return resource_pool::acquire(taskflow, task, requests);
+}
+
+/**
+ * @brief Existing files the last run depended on that are not built by a blueprint, such as sources and headers
+ */
+std::vector<std::string> project::input_files()
+{
+  std::vector<std::string> files;
+  for (const auto &[name, todo]: todo_list)
+    if (!todo.match && name.front() != data_dependency_identifier && stat_cache.exists(name))
+      files.push_back(name);
+  return files;
+}
+
+/**
+ * @brief Prepares the project to run its commands again after some of its input files changed, without evaluating the
+ *        components or blueprints again. Targets with a dependency file written by the last run are matched again so
+ *        headers added or removed by the compiler are picked up.
+ *
+ * @param changed_files   Files that changed since the last run
+ * @param last_run_start  Time the last run started
+ */
+void project::prepare_rebuild(const std::vector<std::string> &changed_files, fs::file_time_type last_run_start)
+{
+  for (const auto &file: changed_files)
+    stat_cache.invalidate(file);
+
+  std::unordered_set<std::string> rematch;
+  for (const auto &[name, match]: target_database.targets)
+    if (match && std::any_of(match->dependency_files.begin(), match->dependency_files.end(), [&](const std::string &dependency_file) {
+          std::error_code ec;
+          return fs::last_write_time(dependency_file, ec) >= last_run_start && !ec;
+        }))
+      rematch.insert(name);
+  for (const auto &name: rematch) {
+    target_database.targets.erase(name);
+    for (const auto &match: blueprint_database.find_match(name, project_summary))
+      target_database.targets.insert({ name, match });
+  }
+  if (!rematch.empty())
+    generate_target_database();
+
+  // The data of this run is now what data dependencies are compared against
+  previous_summary_index = project_summary_index;
+
+  todo_list.clear();
+  todo_task_groups.clear();
+  taskflow.clear();
+  critical_path.clear();
+  failed_targets.clear();
+  abort_build            = false;
+  critical_path_duration = 0;
+  total_work_estimate    = 0;
+}
+
+/**
+ * @brief Prepares a project that was loaded by another process, such as the server, to be built in this one.
+ *        The build records other runs saved since are read again and the targets whose dependency files changed since
+ *        @p load_time are matched again.
+ */
+void project::prepare_loaded_build(fs::file_time_type load_time)
+{
+  stat_cache.clear();
+  task_database.load(task_database_file);
+  deps_log.open(output_path + "/.yakka_deps");
+  prepare_rebuild({}, load_time);
+}
+
+/**
+ * @brief Records a target whose command failed. Once @ref failure_limit targets have failed the build is aborted and
+ *        the processes still running are terminated. Failures of the terminated processes are not recorded.
+ *
+ * @return bool  False if the build was already aborted, in which case the failure should not be reported
+ */
+bool project::fail_target(const std::string &target_name, int retcode)
+{
+  std::lock_guard<std::mutex> lock(failed_targets_lock);
+  if (abort_build)
+    return false;
+  failed_targets.push_back(target_name);
+  if (failure_limit != 0 && failed_targets.size() >= failure_limit) {
+    spdlog::info("Aborting: {} returned {}", target_name, retcode);
+    abort_build = true;
+    yakka::terminate_running_processes();
+  } else {
+    spdlog::info("{} returned {}. Continuing with the targets that don't depend on it", target_name, retcode);
+  }
+  return true;
+}
+
 /**
      * @brief Save to disk the content of the @ref project_summary to yakka_summary.yaml and yakka_summary.json
      *
@@ -1349,6 +1811,10 @@ void project::save_summary()
   json_file << project_summary.dump(3);
   json_file.close();
 
+  // The digests are what the data dependencies of the next run are compared against
+  project_summary_index.build(project_summary);
+  project_summary_index.save(summary_index_file);
+
   std::string template_contribution_filename = project_summary["project_output"].get<std::string>() + "/template_contributions.json";
   // Check if template contribution file exists
   if (fs::exists(template_contribution_filename)) {
@@ -1366,6 +1832,39 @@ void project::save_summary()
   template_contributions_file.close();
 }
 
+/**
+ * @brief Writes the resources used by the processes of each target built in this run to yakka_build_report.json
+ *        and logs the targets with the largest memory footprint.
+ */
+void project::save_build_report()
+{
+  nlohmann::json report = nlohmann::json::object();
+  std::vector<std::pair<uint64_t, std::string>> footprints;
+  for (const auto &[target, task]: todo_list) {
+    if (!task.match || task.usage.peak_memory == 0)
+      continue;
+    const auto duration = task_database.get_duration(target + "|" + task.match->blueprint->target);
+    report[target]      = { { "duration_ms", duration.value_or(0) },
+                            { "peak_memory_kb", task.usage.peak_memory },
+                            { "cpu_ms", task.usage.cpu_time },
+                            { "read_bytes", task.usage.read_bytes },
+                            { "write_bytes", task.usage.write_bytes } };
+    footprints.push_back({ task.usage.peak_memory, target });
+  }
+  if (report.empty())
+    return;
+
+  std::ofstream report_file(output_path + "/yakka_build_report.json");
+  report_file << report.dump(3);
+  report_file.close();
+
+  const auto count = std::min<size_t>(footprints.size(), 5);
+  std::partial_sort(footprints.begin(), footprints.begin() + count, footprints.end(), std::greater<>());
+  spdlog::info("Largest memory footprints:");
+  for (size_t i = 0; i < count; ++i)
+    spdlog::info("- {}: {} kB", footprints[i].second, footprints[i].first);
+}
+
 class custom_error_handler : public nlohmann::json_schema::basic_error_handler {
 public:
   std::string component_name;
@@ -1495,7 +1994,7 @@ void project::process_slc_rules()
       std::unordered_set<std::filesystem::path> added_components;
       // Find all .slcc files in the component paths and add them
       for (const auto &p: c->json["component_path"]) {
-        for (const auto &component_path: glob::rglob(p["path"].get<std::string>() + "/**/*.slcc")) {
+        for (const auto &component_path: directory_cache::get().glob(p["path"].get<std::string>() + "/**/*.slcc")) {
           // Only add component if it hasn't been seen before
           if (added_components.insert(component_path).second == true) {
             std::shared_ptr<yakka::component> new_component = std::make_shared<yakka::component>();
@@ -1722,7 +2221,7 @@ void project::process_blueprints(const std::shared_ptr<component> c)
     for (const auto &[b_key, b_value]: c->json["blueprints"].items()) {
       std::string blueprint_string = try_render(inja_environment, b_value.contains("regex") ? b_value["regex"].get<std::string>() : b_key, project_summary);
       spdlog::info("Additional blueprint: {}", blueprint_string);
-      blueprint_database.blueprints.insert({ blueprint_string, std::make_shared<blueprint>(blueprint_string, b_value, c->json["directory"].get<std::string>()) });
+      blueprint_database.insert(blueprint_string, std::make_shared<blueprint>(blueprint_string, b_value, c->json["directory"].get<std::string>()));
     }
   }
 }
@@ -1736,9 +2235,14 @@ void project::process_tools(const std::shared_ptr<component> c)
         return std::filesystem::absolute(c->component_path).string();
       });
 
-      project_summary["tools"][key] = try_render(inja_env, value.get<std::string>(), project_summary);
+      project_summary["tools"][key] = resolve_tool_path(try_render(inja_env, value.get<std::string>(), project_summary));
     }
   }
+  if (c->json.contains("response_files"))
+    for (const auto &tool: c->json["response_files"])
+      response_file_tools.insert(tool.get<std::string>());
+  if (c->json.contains("resource_pools"))
+    add_resource_pools(c->json["resource_pools"]);
 }
 
 void project::add_additional_tool(const fs::path component_path)
@@ -5,6 +5,15 @@
 #include "yakka_workspace.hpp"
 #include "component_database.hpp"
 #include "blueprint_database.hpp"
+#include "task_database.hpp"
+#include "artifact_cache.hpp"
+#include "jobserver.hpp"
+#include "memory_admission.hpp"
+#include "resource_pool.hpp"
+#include "mpsc_queue.hpp"
+#include "build_trace.hpp"
+#include "stat_cache.hpp"
+#include "template_environment.hpp"
 //#include "yaml-cpp/yaml.h"
 #include "nlohmann/json.hpp"
 #include "inja.hpp"
@@ -16,6 +25,7 @@
 #include <map>
 #include <unordered_set>
 #include <optional>
+#include <mutex>
 #include <functional>
 
 namespace fs = std::filesystem;
@@ -23,7 +33,7 @@ namespace fs = std::filesystem;
 namespace yakka {
 const std::string default_output_directory = "output/";
 
-typedef std::function<yakka::process_return(std::string, const nlohmann::json &, std::string, const nlohmann::json &, inja::Environment &)> blueprint_command;
+typedef std::function<yakka::process_return(std::string, const nlohmann::json &, std::string, const nlohmann::json &, yakka::template_environment &)> blueprint_command;
 
 struct task_group {
   std::string name;
@@ -46,14 +56,31 @@ struct construction_task {
   fs::file_time_type last_modified;
   tf::Task task;
   std::shared_ptr<task_group> group;
+  uint64_t digest;              // Content digest of the target. Only valid when the project uses content hashes
+  uint64_t estimated_duration;  // Milliseconds the command is expected to take, based on previous runs
+  process_usage usage;          // Resources used by the processes the command ran in this build
+  bool failed;                  // The command or one of the commands it depends on failed
+  std::string output;           // Output of the tools the command ran in this build
+  std::vector<std::string> log; // Messages about the command in this build, shown before its output
   // construction_task_state state;
   // std::future<std::pair<std::string, int>> thread_result;
 
-  construction_task() : match(nullptr), last_modified(fs::file_time_type::min())
+  construction_task() : match(nullptr), last_modified(fs::file_time_type::min()), digest(0), estimated_duration(0), failed(false)
   {
   }
 };
 
+/**
+ * @brief Reported by a worker when it finishes the command of a task so the main thread can show its output and progress
+ */
+struct task_event {
+  std::string target;
+  construction_task *task;
+  std::string output;
+  int retcode;
+  std::vector<std::string> log;
+};
+
 class project {
 public:
   enum class state {
@@ -101,8 +128,19 @@ public:
   void set_project_file(const std::string filepath);
   void process_construction(indicators::ProgressBar &bar);
   void save_summary();
+  void save_build_report();
   void save_blueprints();
   void create_tasks(const std::string target_name, tf::Task &parent);
+  void prioritise_tasks();
+  void prefetch_file_status();
+  std::optional<uint64_t> file_digest(const std::string &path);
+  void store_artifact(const std::string &target_name, uint64_t cache_key, const std::vector<std::string> &dependency_files);
+  std::vector<std::string> input_files();
+  void add_resource_pools(const nlohmann::json &pools);
+  tf::Task acquire_resource_pools(tf::Task task, const blueprint &blueprint);
+  void prepare_rebuild(const std::vector<std::string> &changed_files, fs::file_time_type last_run_start);
+  void prepare_loaded_build(fs::file_time_type load_time);
+  bool fail_target(const std::string &target_name, int retcode);
 
   void validate_schema();
 
@@ -127,6 +165,9 @@ public:
   std::unordered_set<std::string> required_components;
   std::unordered_set<std::string> required_features;
   std::unordered_set<std::string> additional_tools;
+  std::unordered_set<std::string> response_file_tools;
+  std::map<std::string, size_t> resource_pool_capacities;
+  std::unordered_set<std::string> resource_pool_warnings;
   std::unordered_set<std::string> commands;
   std::unordered_set<std::string> unknown_components;
   std::vector<std::pair<std::string, std::string>> incomplete_choices;
@@ -141,9 +182,23 @@ public:
   std::vector<std::shared_ptr<yakka::component>> components;
   //yakka::component_database component_database;
   yakka::blueprint_database blueprint_database;
+  yakka::deps_log deps_log;
+  yakka::aggregate_cache aggregate_cache;
   yakka::target_database target_database;
-
-  nlohmann::json previous_summary;
+  yakka::task_database task_database;
+  std::string task_database_file;
+  yakka::artifact_cache artifact_cache;
+  yakka::jobserver jobserver;
+  yakka::memory_admission memory_admission;
+  yakka::build_trace trace;
+  yakka::stat_cache stat_cache;
+  bool content_hash_mode;
+  size_t response_file_threshold;
+
+  std::optional<uint64_t> summary_digest; // Digest of the summary the commands of this build are rendered from
+  yakka::summary_index previous_summary_index;
+  yakka::summary_index project_summary_index;
+  std::string summary_index_file;
   nlohmann::json project_summary;
 
   yakka::workspace &workspace;
@@ -156,10 +211,19 @@ public:
   std::map<std::string, std::shared_ptr<task_group>> todo_task_groups;
 
   tf::Taskflow taskflow;
+  std::map<std::string, resource_pool> resource_pools;
   std::atomic<bool> abort_build;
+  size_t failure_limit; // Failed targets that abort the build. 0 keeps going regardless
+  std::vector<std::string> failed_targets;
+  std::mutex failed_targets_lock;
 
   std::map<std::string, blueprint_command> blueprint_commands;
-  std::function<void(std::shared_ptr<task_group> group)> task_complete_handler;
+  yakka::mpsc_queue<task_event> task_events;
+
+  // Build time estimates from the durations of previous runs
+  std::vector<std::string> critical_path;
+  uint64_t critical_path_duration;
+  uint64_t total_work_estimate;
 
   // SLC specific
   nlohmann::json template_contributions;
@@ -179,4 +243,6 @@ private:
 
 //std::string try_render(inja::Environment& env, const std::string& input, const nlohmann::json& data, std::shared_ptr<spdlog::logger> log);
 std::pair<std::string, int> run_command(const std::string target, construction_task *task, project *project);
+uint64_t command_signature(const std::string target, construction_task *task, project *project);
+uint64_t command_inputs_digest(const std::string target, construction_task *task, uint64_t summary_digest);
 } /* namespace yakka */
@@ -54,6 +54,20 @@ class schema_validator {
             '.*':
               type: object
 
+    response_files:
+      type: array
+      description: Tools that accept arguments in a response file
+      uniqueItems: true
+      items:
+        type: string
+
+    resource_pools:
+      type: object
+      description: Resource pools limiting the blueprints that use them to a number of units at once
+      additionalProperties:
+        type: integer
+        minimum: 1
+
     blueprints:
       type: object
       description: Blueprints
@@ -69,6 +83,13 @@ class schema_validator {
               type: string
             group:
               type: string
+            resources:
+              type: [object, array]
+              additionalProperties:
+                type: integer
+                minimum: 1
+              items:
+                type: string
             depends:
               type: array
             process:
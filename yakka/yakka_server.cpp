@@ -0,0 +1,478 @@
+#include "yakka_server.hpp"
+#include "yakka_component.hpp"
+#include "spdlog/spdlog.h"
+#include "json.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+#include <list>
+
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <unistd.h>
+  #include <sys/socket.h>
+  #include <sys/un.h>
+  #include <sys/wait.h>
+
+extern char **environ;
+#endif
+
+namespace yakka::server {
+#if !defined(_WIN64) && !defined(_WIN32) && !defined(__CYGWIN__)
+// A request is a 32-bit length carrying the standard streams of the client followed by a JSON message of that length
+static const size_t standard_stream_count  = 3;
+static const uint32_t maximum_request_size = 16 * 1024 * 1024;
+static const int32_t version_mismatch      = -2; // Reply to a client of another version instead of an exit code
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+struct request {
+  std::string version;
+  std::string working_directory;
+  std::vector<std::string> arguments;
+  std::vector<std::string> environment;
+  int streams[standard_stream_count] = { -1, -1, -1 };
+};
+
+static bool write_all(int fd, const void *data, size_t size)
+{
+  auto bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    const auto written = ::write(fd, bytes, size);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+static bool read_all(int fd, void *data, size_t size)
+{
+  auto bytes = static_cast<char *>(data);
+  while (size > 0) {
+    const auto bytes_read = ::read(fd, bytes, size);
+    if (bytes_read < 0 && errno == EINTR)
+      continue;
+    if (bytes_read <= 0)
+      return false;
+    bytes += bytes_read;
+    size -= bytes_read;
+  }
+  return true;
+}
+
+static int connect_to_server()
+{
+  sockaddr_un address = {};
+  address.sun_family  = AF_UNIX;
+  std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+std::optional<int> forward_command(int argc, char **argv, const std::string &version)
+{
+  std::error_code ec;
+  if (!std::filesystem::exists(socket_path, ec))
+    return {};
+
+  const int fd = connect_to_server();
+  if (fd < 0)
+    return {};
+
+  nlohmann::json message = { { "version", version }, { "cwd", std::filesystem::current_path().string() }, { "arguments", nlohmann::json::array() }, { "environment", nlohmann::json::array() } };
+  for (int i = 0; i < argc; ++i)
+    message["arguments"].push_back(argv[i]);
+  for (char **variable = environ; *variable != nullptr; ++variable)
+    message["environment"].push_back(*variable);
+  const auto payload = message.dump();
+
+  // The standard streams travel with the length so the server can use them as its own
+  const int streams[standard_stream_count] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+  uint32_t length                          = payload.size();
+  iovec header                             = { &length, sizeof(length) };
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(streams))] = {};
+  msghdr header_message         = {};
+  header_message.msg_iov        = &header;
+  header_message.msg_iovlen     = 1;
+  header_message.msg_control    = control;
+  header_message.msg_controllen = sizeof(control);
+  auto control_message          = CMSG_FIRSTHDR(&header_message);
+  control_message->cmsg_level   = SOL_SOCKET;
+  control_message->cmsg_type    = SCM_RIGHTS;
+  control_message->cmsg_len     = CMSG_LEN(sizeof(streams));
+  std::memcpy(CMSG_DATA(control_message), streams, sizeof(streams));
+
+  int32_t exit_code = -1;
+  if (::sendmsg(fd, &header_message, MSG_NOSIGNAL) != sizeof(length) || !write_all(fd, payload.data(), payload.size()) || !read_all(fd, &exit_code, sizeof(exit_code)))
+    std::cerr << "Lost connection to the Yakka server\n";
+  ::close(fd);
+  if (exit_code == version_mismatch) {
+    std::cerr << "The Yakka server of this workspace runs another version. Running the command without it\n";
+    return {};
+  }
+  return exit_code;
+}
+
+static std::optional<request> receive_request(int fd)
+{
+  request incoming;
+  uint32_t length = 0;
+  iovec header    = { &length, sizeof(length) };
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(incoming.streams))] = {};
+  msghdr header_message         = {};
+  header_message.msg_iov        = &header;
+  header_message.msg_iovlen     = 1;
+  header_message.msg_control    = control;
+  header_message.msg_controllen = sizeof(control);
+  if (::recvmsg(fd, &header_message, MSG_CMSG_CLOEXEC) != sizeof(length))
+    return {};
+
+  auto control_message = CMSG_FIRSTHDR(&header_message);
+  if (control_message == nullptr || control_message->cmsg_type != SCM_RIGHTS || control_message->cmsg_len != CMSG_LEN(sizeof(incoming.streams)))
+    return {};
+  std::memcpy(incoming.streams, CMSG_DATA(control_message), sizeof(incoming.streams));
+
+  const auto close_streams = [&]() {
+    for (auto stream: incoming.streams)
+      ::close(stream);
+  };
+  std::string payload(length, '\0');
+  if (length > maximum_request_size || !read_all(fd, payload.data(), payload.size())) {
+    close_streams();
+    return {};
+  }
+
+  try {
+    const auto message         = nlohmann::json::parse(payload);
+    incoming.version           = message.value("version", "");
+    incoming.working_directory = message["cwd"].get<std::string>();
+    incoming.arguments         = message["arguments"].get<std::vector<std::string>>();
+    incoming.environment       = message["environment"].get<std::vector<std::string>>();
+  } catch (std::exception &e) {
+    spdlog::error("Invalid server request: {}", e.what());
+    close_streams();
+    return {};
+  }
+  return incoming;
+}
+
+/**
+ * @brief Runs a request in the forked child. Never returns.
+ */
+[[noreturn]] static void run_request(request &incoming, const request_handler &handler, int loaded_files_fd)
+{
+  std::signal(SIGINT, SIG_DFL);
+  std::signal(SIGTERM, SIG_DFL);
+  std::signal(SIGPIPE, SIG_DFL);
+
+  for (size_t i = 0; i < standard_stream_count; ++i) {
+    ::dup2(incoming.streams[i], i);
+    ::close(incoming.streams[i]);
+  }
+
+  if (::chdir(incoming.working_directory.c_str()) != 0) {
+    std::cerr << "Cannot change to '" << incoming.working_directory << "'\n";
+    ::_exit(255);
+  }
+
+  ::clearenv();
+  for (const auto &variable: incoming.environment) {
+    const auto separator = variable.find('=');
+    if (separator != std::string::npos)
+      ::setenv(variable.substr(0, separator).c_str(), variable.substr(separator + 1).c_str(), 1);
+  }
+
+  std::vector<char *> argv;
+  for (auto &argument: incoming.arguments)
+    argv.push_back(argument.data());
+  argv.push_back(nullptr);
+
+  const int exit_code = handler(static_cast<int>(incoming.arguments.size()), argv.data());
+  std::cout.flush();
+  std::fflush(nullptr);
+
+  // Report the component files this command parsed so the server can parse them too
+  std::string loaded_files;
+  for (const auto &path: component_file_cache::get().paths())
+    loaded_files.append(path.string() + "\n");
+  write_all(loaded_files_fd, loaded_files.data(), loaded_files.size());
+  ::_exit(exit_code & 0xFF);
+}
+
+/**
+ * @brief Command running in a child forked by the server
+ */
+struct child {
+  pid_t pid;
+  request incoming;
+  int client_fd;
+  int loaded_files_fd; // -1 once the child has closed its end
+  std::string loaded_files;
+  bool interrupted;
+  bool exited;
+  int exit_code;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Written by the SIGCHLD handler so the main loop wakes up to reap the children
+static int child_signal_fd = -1;
+
+/**
+ * @brief Forks a child to run the request. The other clients and the pipes of the server are closed in the child.
+ *
+ * @return The child or nothing when it could not be started, in which case the client has been answered
+ */
+static std::optional<child> start_child(request &incoming, const request_handler &handler, int listen_fd, int client_fd, const std::vector<int> &server_fds)
+{
+  int loaded_files_pipe[2] = { -1, -1 };
+  const auto pid           = ::pipe2(loaded_files_pipe, O_CLOEXEC) == 0 ? ::fork() : -1;
+  if (pid == 0) {
+    std::signal(SIGCHLD, SIG_DFL);
+    ::close(listen_fd);
+    ::close(client_fd);
+    for (auto fd: server_fds)
+      ::close(fd);
+    ::close(loaded_files_pipe[0]);
+    run_request(incoming, handler, loaded_files_pipe[1]);
+  }
+
+  if (pid < 0)
+    spdlog::error("Failed to start command: {}", std::strerror(errno));
+  for (auto &stream: incoming.streams) {
+    ::close(stream);
+    stream = -1;
+  }
+  if (loaded_files_pipe[1] >= 0)
+    ::close(loaded_files_pipe[1]);
+  if (pid < 0) {
+    if (loaded_files_pipe[0] >= 0)
+      ::close(loaded_files_pipe[0]);
+    const int32_t reply = 255;
+    write_all(client_fd, &reply, sizeof(reply));
+    ::close(client_fd);
+    return {};
+  }
+  return child{ pid, std::move(incoming), client_fd, loaded_files_pipe[0], {}, false, false, 0, std::chrono::steady_clock::now() };
+}
+
+/**
+ * @brief Answers the client of a child that has exited and parses the component files the child reported so the next
+ *        command finds them cached
+ */
+static void finish_child(child &finished, const completion_handler &completed)
+{
+  const int32_t reply = finished.exit_code;
+  write_all(finished.client_fd, &reply, sizeof(reply));
+  ::close(finished.client_fd);
+
+  std::string command;
+  for (size_t i = 1; i < finished.incoming.arguments.size(); ++i)
+    command.append(" " + finished.incoming.arguments[i]);
+  std::cout << "yakka" << command << " -> " << finished.exit_code << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - finished.start).count() << " milliseconds" << std::endl;
+
+  std::istringstream paths(finished.loaded_files);
+  std::string path;
+  while (std::getline(paths, path)) {
+    try {
+      component_file_cache::get().load(path);
+    } catch (std::exception &e) {
+      spdlog::info("Not caching '{}': {}", path, e.what());
+    }
+  }
+
+  completed(finished.incoming.arguments, finished.incoming.working_directory, finished.incoming.environment, finished.exit_code);
+}
+
+int serve(const std::string &version, const std::function<void()> &refresh, const request_handler &handler, const completion_handler &completed)
+{
+  if (std::filesystem::exists(socket_path)) {
+    const int fd = connect_to_server();
+    if (fd >= 0) {
+      ::close(fd);
+      spdlog::error("A Yakka server is already running in this workspace");
+      return -1;
+    }
+    std::filesystem::remove(socket_path);
+  }
+  std::filesystem::create_directories(socket_path.parent_path());
+
+  sockaddr_un address = {};
+  address.sun_family  = AF_UNIX;
+  std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(listen_fd, 16) != 0) {
+    spdlog::error("Failed to listen on '{}': {}", socket_path.string(), std::strerror(errno));
+    return -1;
+  }
+
+  int child_signal_pipe[2] = { -1, -1 };
+  if (::pipe2(child_signal_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    spdlog::error("Failed to create the child signal pipe: {}", std::strerror(errno));
+    ::close(listen_fd);
+    return -1;
+  }
+  child_signal_fd = child_signal_pipe[1];
+
+  // Stop cleanly on Ctrl+C so the socket is removed
+  struct sigaction stop_action = {};
+  stop_action.sa_handler       = [](int) {
+    stop_requested = 1;
+  };
+  ::sigaction(SIGINT, &stop_action, nullptr);
+  ::sigaction(SIGTERM, &stop_action, nullptr);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  struct sigaction child_action = {};
+  child_action.sa_handler       = [](int) {
+    const int saved_errno = errno;
+    const char signal     = 0;
+    [[maybe_unused]] const auto written = ::write(child_signal_fd, &signal, 1);
+    errno = saved_errno;
+  };
+  child_action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  ::sigaction(SIGCHLD, &child_action, nullptr);
+
+  component_file_cache::get().enable();
+  refresh();
+  std::cout << "Serving '" << std::filesystem::current_path().string() << "' on " << socket_path.string() << ". Press Ctrl+C to stop" << std::endl;
+
+  // Commands run concurrently. Each child is finished once it has been reaped and has closed its end of the pipe
+  std::list<child> children;
+  while (!stop_requested) {
+    std::vector<pollfd> poll_fds = { { listen_fd, POLLIN, 0 }, { child_signal_pipe[0], POLLIN, 0 } };
+    for (const auto &c: children) {
+      poll_fds.push_back({ c.loaded_files_fd, POLLIN, 0 });
+      poll_fds.push_back({ c.interrupted ? -1 : c.client_fd, POLLIN, 0 });
+    }
+    if (::poll(poll_fds.data(), poll_fds.size(), -1) < 0)
+      continue;
+
+    // A client going away interrupts its command. The client is not watched afterwards
+    auto poll_fd = poll_fds.begin() + 2;
+    for (auto &c: children) {
+      if (poll_fd->revents != 0) {
+        char buffer[4096];
+        const auto bytes_read = ::read(c.loaded_files_fd, buffer, sizeof(buffer));
+        if (bytes_read > 0)
+          c.loaded_files.append(buffer, bytes_read);
+        else if (bytes_read == 0 || errno != EINTR) {
+          ::close(c.loaded_files_fd);
+          c.loaded_files_fd = -1;
+        }
+      }
+      ++poll_fd;
+      if (poll_fd->revents != 0) {
+        if (!c.exited)
+          ::kill(c.pid, SIGINT);
+        c.interrupted = true;
+      }
+      ++poll_fd;
+    }
+
+    if (poll_fds[1].revents != 0) {
+      char buffer[64];
+      while (::read(child_signal_pipe[0], buffer, sizeof(buffer)) > 0) {
+      }
+      for (auto &c: children) {
+        int status = 0;
+        if (c.exited || ::waitpid(c.pid, &status, WNOHANG) != c.pid)
+          continue;
+        c.exited    = true;
+        c.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+      }
+    }
+
+    for (auto c = children.begin(); c != children.end();) {
+      if (c->exited && c->loaded_files_fd < 0) {
+        finish_child(*c, completed);
+        c = children.erase(c);
+      } else
+        ++c;
+    }
+
+    if (poll_fds[0].revents == 0)
+      continue;
+    const int client_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client_fd < 0)
+      continue;
+
+    auto incoming = receive_request(client_fd);
+    if (!incoming) {
+      ::close(client_fd);
+      continue;
+    }
+
+    // A client of another version may parse arguments or files differently so it runs the command itself
+    if (incoming->version != version) {
+      std::cout << "Refusing a command from Yakka " << (incoming->version.empty() ? "of an unknown version" : incoming->version) << std::endl;
+      for (auto stream: incoming->streams)
+        ::close(stream);
+      write_all(client_fd, &version_mismatch, sizeof(version_mismatch));
+      ::close(client_fd);
+      continue;
+    }
+
+    refresh();
+    std::vector<int> server_fds = { child_signal_pipe[0], child_signal_pipe[1] };
+    for (const auto &c: children) {
+      server_fds.push_back(c.client_fd);
+      if (c.loaded_files_fd >= 0)
+        server_fds.push_back(c.loaded_files_fd);
+    }
+    auto started = start_child(*incoming, handler, listen_fd, client_fd, server_fds);
+    if (started)
+      children.push_back(std::move(*started));
+  }
+
+  // The commands still running are interrupted. Their clients see the connection close
+  for (auto &c: children) {
+    if (!c.exited) {
+      ::kill(c.pid, SIGINT);
+      while (::waitpid(c.pid, nullptr, 0) < 0 && errno == EINTR) {
+      }
+    }
+    if (c.loaded_files_fd >= 0)
+      ::close(c.loaded_files_fd);
+    ::close(c.client_fd);
+  }
+  std::signal(SIGCHLD, SIG_DFL);
+  ::close(child_signal_pipe[0]);
+  ::close(child_signal_pipe[1]);
+  child_signal_fd = -1;
+
+  ::close(listen_fd);
+  std::error_code ec;
+  std::filesystem::remove(socket_path, ec);
+  std::cout << "Server stopped" << std::endl;
+  return 0;
+}
+#else
+std::optional<int> forward_command(int argc, char **argv, const std::string &version)
+{
+  return {};
+}
+
+int serve(const std::string &version, const std::function<void()> &refresh, const request_handler &handler, const completion_handler &completed)
+{
+  spdlog::error("The Yakka server is not supported on this platform");
+  return -1;
+}
+#endif
+} // namespace yakka::server
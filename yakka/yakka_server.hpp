@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace yakka::server {
+/**
+ * @brief Socket of the server of the workspace in the current directory
+ */
+const std::filesystem::path socket_path = ".yakka/server.sock";
+
+/**
+ * @brief Environment variable that passes commands to the server when set to 1, like the `--server` option
+ */
+const std::string server_variable = "YAKKA_SERVER";
+
+using request_handler = std::function<int(int argc, char **argv)>;
+
+/**
+ * @brief Called by the server once a command has exited, with the arguments, working directory and environment it ran with
+ */
+using completion_handler = std::function<void(const std::vector<std::string> &arguments, const std::string &working_directory, const std::vector<std::string> &environment, int exit_code)>;
+
+/**
+ * @brief Runs a command in the server of the workspace when one is listening and runs the same @p version.
+ *        The arguments, environment, working directory and standard streams of this process are passed to the server.
+ *
+ * @return Exit code of the command or nothing when there is no server or it runs another version
+ */
+std::optional<int> forward_command(int argc, char **argv, const std::string &version);
+
+/**
+ * @brief Serves commands from clients of the same @p version until interrupted.
+ *        Each command runs in a child forked from the server so it starts from the warm state of the server without being
+ *        able to change it. Commands run concurrently and the children are reaped as SIGCHLD reports them.
+ *        @p refresh is called before every fork to reload state that changed on disk. The component files parsed by a
+ *        command are parsed by the server afterwards so the next command finds them in the component file cache, and
+ *        @p completed is called so the caller can keep more of the state of the command for the next one.
+ */
+int serve(const std::string &version, const std::function<void()> &refresh, const request_handler &handler, const completion_handler &completed);
+} // namespace yakka::server